@@ -34,5 +34,6 @@ void Barrier::wait() {
 
 Barrier::~Barrier() {
     sem_destroy(&sem);
+    sem_destroy(&sem2);
     pthread_mutex_destroy(&m);
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef COARSE_LIST_H_
+#define COARSE_LIST_H_
+
+#include <pthread.h>
+#include <iostream>
+#include <iomanip> // std::setw
+
+/**
+ * A sorted set with the interface of List (ThreadSafeList.h) under a single reader-writer lock.
+ * Lookups share the lock, so they run in parallel with each other, and every insert or remove excludes everyone.
+ * The baseline the fine grained lists are measured against.
+ * T must support operator< and operator==.
+ */
+template <typename T>
+class CoarseList
+{
+    public:
+        class Node {
+         public:
+          Node *next;
+          T data;
+          explicit Node(const T& data_in, Node* next_in = nullptr) : next(next_in), data(data_in) {}
+        };
+
+        /**
+         * Constructor
+         */
+        CoarseList() : head(nullptr), counter(0) {
+            pthread_rwlock_init(&lock, nullptr);
+        }
+
+        /**
+         * Destructor
+         */
+        virtual ~CoarseList() {
+            while(head != nullptr){
+                Node* tmp = head;
+                head = head->next;
+                delete tmp;
+            }
+            pthread_rwlock_destroy(&lock);
+        }
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            pthread_rwlock_wrlock(&lock);
+            Node** link = find(data);
+            if(*link != nullptr && (*link)->data == data){
+                pthread_rwlock_unlock(&lock);
+                return false;
+            }
+            *link = new Node(data, *link);
+            ++counter;
+            pthread_rwlock_unlock(&lock);
+            __insert_test_hook();
+            return true;
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            pthread_rwlock_wrlock(&lock);
+            Node** link = find(value);
+            if(*link == nullptr || !((*link)->data == value)){
+                pthread_rwlock_unlock(&lock);
+                return false;
+            }
+            Node* node = *link;
+            *link = node->next;
+            --counter;
+            pthread_rwlock_unlock(&lock);
+            delete node;
+            __remove_test_hook();
+            return true;
+        }
+
+        /**
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            pthread_rwlock_rdlock(&lock);
+            Node** link = find(value);
+            bool found = *link != nullptr && (*link)->data == value;
+            pthread_rwlock_unlock(&lock);
+            return found;
+        }
+
+        /**
+         * Returns the current size of the list
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            pthread_rwlock_rdlock(&lock);
+            unsigned int i = counter;
+            pthread_rwlock_unlock(&lock);
+            return i;
+        }
+
+		// Don't remove
+        void print() {
+          pthread_rwlock_rdlock(&lock);
+          for (Node* temp = head; temp != nullptr; temp = temp->next)
+          {
+            std::cout << std::right << std::setw(3) << temp->data << " ";
+          }
+          pthread_rwlock_unlock(&lock);
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+private:
+    pthread_rwlock_t lock;
+    Node* head;
+    unsigned int counter;
+
+    //the link which points to the first node whose data isn't smaller than @param key
+    Node** find(const T& key) {
+        Node** link = &head;
+        while(*link != nullptr && (*link)->data < key){
+            link = &(*link)->next;
+        }
+        return link;
+    }
+};
+
+#endif //COARSE_LIST_H_
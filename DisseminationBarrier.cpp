@@ -0,0 +1,31 @@
+#include "Futex.h"
+#include "DisseminationBarrier.h"
+
+static unsigned int roundsOf(unsigned int num_of_threads){
+    unsigned int rounds = 0;
+    while((1u << rounds) < num_of_threads){
+        ++rounds;
+    }
+    return rounds;
+}
+
+DisseminationBarrier::DisseminationBarrier(unsigned int num_of_threads) : num_of_threads(num_of_threads)
+        , rounds(roundsOf(num_of_threads)), flags(num_of_threads * rounds), phases(num_of_threads), tickets(0)
+        , spin_limit(defaultSpinLimit()) {
+}
+
+void DisseminationBarrier::wait() {
+    //a thread leaves a phase only after all of it took their tickets, so every phase gets all the ids once
+    wait(tickets.fetch_add(1, std::memory_order_relaxed) % num_of_threads);
+}
+
+void DisseminationBarrier::wait(unsigned int id) {
+    unsigned int phase = ++phases[id].value;
+    for(unsigned int r = 0; r < rounds; ++r){
+        Flag& partner = flags[((id + (1u << r)) % num_of_threads) * rounds + r];
+        addAndWake(partner.signals, 1, partner.sleepers);
+        //a signal of the next phase may come early, the flag then passes phase and that's fine
+        Flag& mine = flags[id * rounds + r];
+        waitUntil(mine.signals, phase, mine.sleepers, spin_limit);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef DISSEMINATION_BARRIER_H_
+#define DISSEMINATION_BARRIER_H_
+
+#include <atomic>
+#include <vector>
+
+/**
+ * A drop-in replacement of Barrier (Barrier.h) for many threads, with no root to wait for.
+ * A phase has ceil(log2(n)) rounds, in round r thread i signals thread (i + 2^r) % n and waits for the signal
+ * of thread (i - 2^r) % n. After the last round every thread heard, directly or not, from all the others.
+ * Every thread spins only on its own flags, each on a cache line of its own.
+ * wait(id) is the cheaper call, every thread passes a different id in [0, num_of_threads) and keeps it
+ * for all the phases. wait() hands out the ids by order of arrival, which costs one shared atomic increment.
+ */
+class DisseminationBarrier {
+    struct alignas(64) Flag {
+        //signals received, one per phase
+        std::atomic<unsigned int> signals;
+        //threads which may sleep on signals
+        std::atomic<unsigned int> sleepers;
+        Flag() : signals(0), sleepers(0) {}
+    };
+    struct alignas(64) Phase {
+        //phases passed by the thread of this id, touched only by it
+        unsigned int value = 0;
+    };
+    const unsigned int num_of_threads;
+    const unsigned int rounds;
+    //the flag of thread i for round r is flags[i * rounds + r]
+    std::vector<Flag> flags;
+    std::vector<Phase> phases;
+    //hands out the ids of wait(), ticket % num_of_threads
+    std::atomic<unsigned long> tickets;
+    const unsigned int spin_limit;
+public:
+    /**
+     * @param num_of_threads number of threads which wait on the barrier every phase
+     */
+    explicit DisseminationBarrier(unsigned int num_of_threads);
+    void wait();
+    /**
+     * @param id the id of the calling thread, in [0, num_of_threads)
+     */
+    void wait(unsigned int id);
+    ~DisseminationBarrier() = default;
+
+};
+
+#endif // DISSEMINATION_BARRIER_H_
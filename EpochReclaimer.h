@@ -0,0 +1,157 @@
+#ifndef EPOCH_RECLAIMER_H_
+#define EPOCH_RECLAIMER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Epoch based reclamation of the nodes of lock-free data structures.
+ * A thread reads shared nodes only inside a Guard, and a node which has been unlinked is handed to retire()
+ * instead of being deleted. The global epoch advances only once every thread which is inside a Guard has
+ * seen the current one, so a node retired in epoch e can't be reached by anyone once the epoch reaches e+2,
+ * and is deleted then.
+ * A thread which stays inside a Guard forever blocks all reclamation, so guards should be short.
+ */
+class EpochReclaimer {
+    //the state of a single thread, records are never freed, a record of a thread which exited is reused by the next one
+    struct Record {
+        //the epoch the thread has seen shifted left by one, the low bit is set while the thread is inside a Guard
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> in_use{true};
+        Record* next = nullptr;
+
+        //nodes retired by the thread, bin i holds the nodes of the last epoch e with e%3 == i
+        struct Retired {
+            void* ptr;
+            void (*deleter)(void*);
+        };
+        std::vector<Retired> limbo[3];
+        uint64_t limbo_epoch[3] = {0, 0, 0};
+        unsigned int retired_since_scan = 0;
+        unsigned int guard_depth = 0;
+    };
+
+    //owns the calling thread's record and gives it back when the thread exits
+    struct RecordHolder {
+        Record* record;
+        RecordHolder() : record(nullptr) {}
+        ~RecordHolder() {
+            if(record != nullptr){
+                record->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    //every how many retired nodes a thread tries to advance the epoch and reclaim its old ones
+    static const unsigned int SCAN_THRESHOLD = 64;
+
+    inline static std::atomic<uint64_t> global_epoch{2};
+    inline static std::atomic<Record*> records{nullptr};
+    inline static thread_local RecordHolder holder;
+
+    static Record* threadRecord() {
+        if(holder.record != nullptr){
+            return holder.record;
+        }
+        for(Record* rec = records.load(std::memory_order_acquire); rec != nullptr; rec = rec->next){
+            bool expected = false;
+            if(!rec->in_use.load(std::memory_order_relaxed)
+                    && rec->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)){
+                holder.record = rec;
+                return rec;
+            }
+        }
+        Record* rec = new Record();
+        Record* head = records.load(std::memory_order_relaxed);
+        do {
+            rec->next = head;
+        } while(!records.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+        holder.record = rec;
+        return rec;
+    }
+
+    /**
+     * Advances the global epoch if every thread which is inside a Guard has seen the current one
+     * @return the global epoch after the attempt
+     */
+    static uint64_t tryAdvance() {
+        uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        for(Record* rec = records.load(std::memory_order_acquire); rec != nullptr; rec = rec->next){
+            uint64_t seen = rec->epoch.load(std::memory_order_seq_cst);
+            if((seen & 1) && (seen >> 1) != epoch){
+                return epoch;
+            }
+        }
+        if(global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst)){
+            return epoch + 1;
+        }
+        return epoch;
+    }
+
+    static void freeBin(Record* rec, unsigned int bin) {
+        for(auto& retired : rec->limbo[bin]){
+            retired.deleter(retired.ptr);
+        }
+        rec->limbo[bin].clear();
+    }
+
+    static void collect(Record* rec, uint64_t epoch) {
+        for(unsigned int i = 0; i < 3; ++i){
+            if(!rec->limbo[i].empty() && rec->limbo_epoch[i] + 2 <= epoch){
+                freeBin(rec, i);
+            }
+        }
+    }
+
+public:
+    /**
+     * While a Guard lives, no node which the thread may still reach is deleted. Guards may be nested
+     */
+    class Guard {
+        Record* rec;
+    public:
+        Guard() : rec(threadRecord()) {
+            if(rec->guard_depth++ == 0){
+                //the epoch may advance before our announcement is visible, then we announce the new one
+                uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+                uint64_t announced;
+                do {
+                    announced = epoch;
+                    rec->epoch.store((announced << 1) | 1, std::memory_order_seq_cst);
+                    epoch = global_epoch.load(std::memory_order_seq_cst);
+                } while(epoch != announced);
+            }
+        }
+        ~Guard() {
+            if(--rec->guard_depth == 0){
+                rec->epoch.store(rec->epoch.load(std::memory_order_relaxed) & ~uint64_t(1), std::memory_order_release);
+            }
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    /**
+     * Deletes @param ptr once no thread can reach it anymore
+     * @param ptr a node which has been unlinked, so no thread which starts a Guard from now on can reach it
+     */
+    template <typename Node>
+    static void retire(Node* ptr) {
+        Record* rec = threadRecord();
+        uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        unsigned int bin = epoch % 3;
+        //the bin holds nodes of epoch-3 or older, which are safe to delete by now
+        if(rec->limbo_epoch[bin] != epoch){
+            freeBin(rec, bin);
+            rec->limbo_epoch[bin] = epoch;
+        }
+        rec->limbo[bin].push_back({ptr, [](void* p){ delete static_cast<Node*>(p); }});
+        if(++rec->retired_since_scan >= SCAN_THRESHOLD){
+            rec->retired_since_scan = 0;
+            collect(rec, tryAdvance());
+        }
+    }
+};
+
+#endif //EPOCH_RECLAIMER_H_
@@ -0,0 +1,82 @@
+#ifndef FUTEX_H_
+#define FUTEX_H_
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <climits>
+#include <thread>
+
+/*
+ * spin-then-sleep waiting on a 32 bit counter, shared by the barriers.
+ * a waiter spins for a while and then sleeps on the counter with a futex, counting itself in a sleepers word
+ * so the thread which advances the counter enters the kernel only when someone is actually asleep.
+ */
+
+//how many times a waiter checks the counter before it goes to sleep, on a single cpu spinning only delays the thread it waits for
+#define FUTEX_SPIN_LIMIT 4000
+
+inline unsigned int defaultSpinLimit(){
+    return std::thread::hardware_concurrency() > 1 ? FUTEX_SPIN_LIMIT : 0;
+}
+
+inline void cpuRelax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+inline void futexWait(std::atomic<unsigned int>* addr, unsigned int expected){
+    syscall(SYS_futex, reinterpret_cast<unsigned int*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+inline void futexWakeAll(std::atomic<unsigned int>* addr){
+    syscall(SYS_futex, reinterpret_cast<unsigned int*>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+//the counters wrap around, target is reached once it's at most 2^31 behind
+inline bool reached(unsigned int value, unsigned int target){
+    return (int)(value - target) >= 0;
+}
+
+/*
+ * waits until counter reaches target.
+ */
+inline void waitUntil(std::atomic<unsigned int>& counter, unsigned int target, std::atomic<unsigned int>& sleepers,
+        unsigned int spin_limit){
+    for(unsigned int i = 0; i < spin_limit; ++i){
+        if(reached(counter.load(std::memory_order_acquire), target)){
+            return;
+        }
+        cpuRelax();
+    }
+    //announce before the last check, so either the waker sees us or we see its update
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    unsigned int value;
+    while(!reached(value = counter.load(std::memory_order_seq_cst), target)){
+        futexWait(&counter, value);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/*
+ * sets counter to value (or adds to it) and wakes whoever sleeps on it.
+ */
+inline void storeAndWake(std::atomic<unsigned int>& counter, unsigned int value, std::atomic<unsigned int>& sleepers){
+    counter.store(value, std::memory_order_seq_cst);
+    if(sleepers.load(std::memory_order_seq_cst) != 0){
+        futexWakeAll(&counter);
+    }
+}
+
+inline void addAndWake(std::atomic<unsigned int>& counter, unsigned int delta, std::atomic<unsigned int>& sleepers){
+    counter.fetch_add(delta, std::memory_order_seq_cst);
+    if(sleepers.load(std::memory_order_seq_cst) != 0){
+        futexWakeAll(&counter);
+    }
+}
+
+#endif // FUTEX_H_
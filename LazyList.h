@@ -0,0 +1,205 @@
+#ifndef LAZY_LIST_H_
+#define LAZY_LIST_H_
+
+#include <pthread.h>
+#include <atomic>
+#include <iostream>
+#include <iomanip> // std::setw
+#include "EpochReclaimer.h"
+
+/**
+ * A sorted set with the interface of List (ThreadSafeList.h) which locks lazily (the lazy list of Heller et al.).
+ * Traversals take no locks. A writer locks only the pred/curr pair it changes, then validates that both are still
+ * in the list and adjacent, and starts over if not. A node is removed logically by marking it, before it's unlinked,
+ * so contains() needs no locks and never retries.
+ * Removed nodes are deleted through EpochReclaimer.
+ * T must support operator< and operator==.
+ */
+template <typename T>
+class LazyList
+{
+    public:
+        /**
+         * The part of a node the traversals need, the head of the list is a bare Link
+         */
+        class Link {
+         public:
+          std::atomic<Link*> next;
+          pthread_mutex_t m;
+          std::atomic<bool> marked;
+          explicit Link(Link* next_in = nullptr) : next(next_in), m(PTHREAD_MUTEX_INITIALIZER), marked(false) {}
+          virtual ~Link() {
+              pthread_mutex_destroy(&m);
+          }
+        };
+
+        class Node : public Link {
+         public:
+          T data;
+          explicit Node(const T& data_in, Link* next_in = nullptr) : Link(next_in), data(data_in) {}
+        };
+
+        /**
+         * Constructor
+         */
+        LazyList() : counter(0) {}
+
+        /**
+         * Destructor, no other thread may use the list anymore
+         */
+        virtual ~LazyList() {
+            Link* node = head.next.load(std::memory_order_relaxed);
+            while(node != nullptr){
+                Link* tmp = node;
+                node = node->next.load(std::memory_order_relaxed);
+                delete tmp;
+            }
+        }
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            EpochReclaimer::Guard guard;
+            //built before any lock is taken, nobody can see it until it's linked
+            Node* node = new Node(data);
+            while(true){
+                Link *pred, *curr;
+                find(data, pred, curr);
+                lock(pred, curr);
+                if(!validate(pred, curr)){
+                    unlock(pred, curr);
+                    continue;
+                }
+                if(curr != nullptr && dataOf(curr) == data){
+                    unlock(pred, curr);
+                    delete node;
+                    return false;
+                }
+                node->next.store(curr, std::memory_order_relaxed);
+                pred->next.store(node, std::memory_order_release);
+                unlock(pred, curr);
+                counter.fetch_add(1, std::memory_order_relaxed);
+                __insert_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            EpochReclaimer::Guard guard;
+            while(true){
+                Link *pred, *curr;
+                find(value, pred, curr);
+                lock(pred, curr);
+                if(!validate(pred, curr)){
+                    unlock(pred, curr);
+                    continue;
+                }
+                if(curr == nullptr || !(dataOf(curr) == value)){
+                    unlock(pred, curr);
+                    return false;
+                }
+                //from here contains() won't find it, even though traversals may still pass through it
+                curr->marked.store(true, std::memory_order_release);
+                pred->next.store(curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+                unlock(pred, curr);
+                EpochReclaimer::retire(curr);
+                counter.fetch_sub(1, std::memory_order_relaxed);
+                __remove_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Wait-free lookup, it takes no locks
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            EpochReclaimer::Guard guard;
+            Link *pred, *curr;
+            find(value, pred, curr);
+            return curr != nullptr && dataOf(curr) == value && !curr->marked.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Returns the current size of the list
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            return counter.load(std::memory_order_relaxed);
+        }
+
+		// Don't remove
+        void print() {
+          EpochReclaimer::Guard guard;
+          Link* temp = head.next.load(std::memory_order_acquire);
+          while (temp != nullptr)
+          {
+            if (!temp->marked.load(std::memory_order_acquire))
+            {
+              std::cout << std::right << std::setw(3) << dataOf(temp) << " ";
+            }
+            temp = temp->next.load(std::memory_order_acquire);
+          }
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+private:
+    Link head;
+    std::atomic<int> counter;
+
+    static const T& dataOf(Link* link) {
+        return static_cast<Node*>(link)->data;
+    }
+
+    /**
+     * Finds, without locking, the first node whose data isn't smaller than @param key
+     * @param pred set to the node before it
+     * @param curr set to that node, or nullptr if there's none
+     */
+    void find(const T& key, Link*& pred, Link*& curr) {
+        pred = &head;
+        curr = pred->next.load(std::memory_order_acquire);
+        while(curr != nullptr && dataOf(curr) < key){
+            pred = curr;
+            curr = curr->next.load(std::memory_order_acquire);
+        }
+    }
+
+    //both are still in the list and curr still follows pred, expects both to be locked
+    static bool validate(Link* pred, Link* curr) {
+        return !pred->marked.load(std::memory_order_relaxed)
+                && (curr == nullptr || !curr->marked.load(std::memory_order_relaxed))
+                && pred->next.load(std::memory_order_relaxed) == curr;
+    }
+
+    static void lock(Link* pred, Link* curr) {
+        pthread_mutex_lock(&pred->m);
+        if(curr != nullptr){
+            pthread_mutex_lock(&curr->m);
+        }
+    }
+
+    static void unlock(Link* pred, Link* curr) {
+        if(curr != nullptr){
+            pthread_mutex_unlock(&curr->m);
+        }
+        pthread_mutex_unlock(&pred->m);
+    }
+};
+
+#endif //LAZY_LIST_H_
@@ -0,0 +1,54 @@
+#ifndef LIST_POLICIES_H_
+#define LIST_POLICIES_H_
+
+#include "ThreadSafeList.h"
+#include "CoarseList.h"
+#include "LazyList.h"
+#include "LockFreeList.h"
+
+/**
+ * Picks the locking strategy of a sorted set at compile time:
+ *     ConcurrentList<int, OptimisticPolicy> set;
+ * Every policy's set provides insert, remove, contains, getSize, print and the test hooks.
+ */
+
+//fine grained: a mutex per node, locked hand over hand (List)
+struct HandOverHandPolicy {
+    template <typename T>
+    using set = List<T>;
+    static const char* name() {
+        return "hand-over-hand";
+    }
+};
+
+//coarse grained: a single pthread_rwlock_t, lookups share it (CoarseList)
+struct CoarseRWLockPolicy {
+    template <typename T>
+    using set = CoarseList<T>;
+    static const char* name() {
+        return "coarse-rwlock";
+    }
+};
+
+//optimistic: lock-free traversals, writers lock two nodes and validate them (LazyList)
+struct OptimisticPolicy {
+    template <typename T>
+    using set = LazyList<T>;
+    static const char* name() {
+        return "optimistic";
+    }
+};
+
+//lock-free: marked pointers and compare-and-swap (LockFreeList)
+struct LockFreePolicy {
+    template <typename T>
+    using set = LockFreeList<T>;
+    static const char* name() {
+        return "lock-free";
+    }
+};
+
+template <typename T, typename Policy = HandOverHandPolicy>
+using ConcurrentList = typename Policy::template set<T>;
+
+#endif //LIST_POLICIES_H_
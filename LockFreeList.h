@@ -0,0 +1,198 @@
+#ifndef LOCK_FREE_LIST_H_
+#define LOCK_FREE_LIST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <iomanip> // std::setw
+#include "EpochReclaimer.h"
+
+/**
+ * A lock-free sorted set (Harris' list with Michael's reclamation-friendly unlinking).
+ * A node is removed in two steps: first its next pointer is marked, which removes it logically and freezes it,
+ * then it is unlinked from its predecessor, by the remover or by any traversal which finds it marked.
+ * Unlinked nodes are deleted through EpochReclaimer, every operation runs inside a Guard.
+ * T must support operator< and operator==.
+ */
+template <typename T>
+class LockFreeList
+{
+    public:
+        class Node {
+         public:
+          T data;
+          //the low bit marks this node (not the next one) as removed
+          std::atomic<uintptr_t> next;
+          explicit Node(const T& data_in, uintptr_t next_in = 0) : data(data_in), next(next_in) {}
+        };
+
+        /**
+         * Constructor
+         */
+        LockFreeList() : head(0), counter(0) {}
+
+        /**
+         * Destructor, no other thread may use the list anymore
+         */
+        ~LockFreeList() {
+            Node* node = pointer(head.load(std::memory_order_relaxed));
+            while(node != nullptr){
+                Node* tmp = node;
+                node = pointer(node->next.load(std::memory_order_relaxed));
+                delete tmp;
+            }
+        }
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            EpochReclaimer::Guard guard;
+            Node* node = nullptr;
+            while(true){
+                std::atomic<uintptr_t>* pred;
+                Node* curr;
+                if(find(data, pred, curr)){
+                    delete node;
+                    return false;
+                }
+                if(node == nullptr){
+                    node = new Node(data);
+                }
+                node->next.store(reinterpret_cast<uintptr_t>(curr), std::memory_order_relaxed);
+                uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+                if(pred->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node))){
+                    counter.fetch_add(1, std::memory_order_relaxed);
+                    __insert_test_hook();
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            EpochReclaimer::Guard guard;
+            while(true){
+                std::atomic<uintptr_t>* pred;
+                Node* curr;
+                if(!find(value, pred, curr)){
+                    return false;
+                }
+                uintptr_t next = curr->next.load(std::memory_order_acquire);
+                if(isMarked(next)){
+                    continue;
+                }
+                //the node is removed once it's marked, whoever marks it owns the removal
+                if(!curr->next.compare_exchange_strong(next, next | MARK)){
+                    continue;
+                }
+                uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+                if(pred->compare_exchange_strong(expected, next)){
+                    EpochReclaimer::retire(curr);
+                } else {
+                    //let a traversal unlink it
+                    find(value, pred, curr);
+                }
+                counter.fetch_sub(1, std::memory_order_relaxed);
+                __remove_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Wait-free lookup, it never writes to the list nor restarts
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            EpochReclaimer::Guard guard;
+            Node* curr = pointer(head.load(std::memory_order_acquire));
+            while(curr != nullptr && curr->data < value){
+                curr = pointer(curr->next.load(std::memory_order_acquire));
+            }
+            return curr != nullptr && curr->data == value && !isMarked(curr->next.load(std::memory_order_acquire));
+        }
+
+        /**
+         * Returns the current size of the list
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            return counter.load(std::memory_order_relaxed);
+        }
+
+		// Don't remove
+        void print() {
+          EpochReclaimer::Guard guard;
+          Node* temp = pointer(head.load(std::memory_order_acquire));
+          while (temp != nullptr)
+          {
+            uintptr_t next = temp->next.load(std::memory_order_acquire);
+            if (!isMarked(next))
+            {
+              std::cout << std::right << std::setw(3) << temp->data << " ";
+            }
+            temp = pointer(next);
+          }
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+private:
+    static const uintptr_t MARK = 1;
+
+    std::atomic<uintptr_t> head;
+    std::atomic<int> counter;
+
+    static bool isMarked(uintptr_t link) {
+        return link & MARK;
+    }
+
+    static Node* pointer(uintptr_t link) {
+        return reinterpret_cast<Node*>(link & ~MARK);
+    }
+
+    /**
+     * Finds the first node whose data isn't smaller than @param key, unlinking the marked nodes on the way
+     * @param pred set to the link which points to curr
+     * @param curr set to that node, or nullptr if there's none
+     * @return true if curr's data equals to @param key
+     */
+    bool find(const T& key, std::atomic<uintptr_t>*& pred, Node*& curr) {
+retry:
+        pred = &head;
+        curr = pointer(pred->load(std::memory_order_acquire));
+        while(curr != nullptr){
+            uintptr_t next = curr->next.load(std::memory_order_acquire);
+            if(isMarked(next)){
+                //fails if pred has been marked or changed meanwhile, then we start over
+                uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+                if(!pred->compare_exchange_strong(expected, next & ~MARK)){
+                    goto retry;
+                }
+                EpochReclaimer::retire(curr);
+                curr = pointer(next);
+                continue;
+            }
+            if(!(curr->data < key)){
+                return curr->data == key;
+            }
+            pred = &curr->next;
+            curr = pointer(next);
+        }
+        return false;
+    }
+};
+
+#endif //LOCK_FREE_LIST_H_
@@ -0,0 +1,78 @@
+#ifndef LOCKS_H_
+#define LOCKS_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock policies of List (ThreadSafeList.h). A policy is default constructible and provides lock() and unlock().
+ */
+
+/**
+ * A pthread mutex, waiters sleep in the kernel
+ */
+class MutexLock {
+    pthread_mutex_t m;
+public:
+    MutexLock() {
+        pthread_mutex_init(&m, nullptr);
+    }
+    ~MutexLock() {
+        pthread_mutex_destroy(&m);
+    }
+    MutexLock(const MutexLock&) = delete;
+    MutexLock& operator=(const MutexLock&) = delete;
+
+    void lock() {
+        pthread_mutex_lock(&m);
+    }
+    void unlock() {
+        pthread_mutex_unlock(&m);
+    }
+};
+
+/**
+ * A single byte test-and-test-and-set spinlock.
+ * Waiters spin on a plain load, so they don't steal the cache line from the owner, and back off exponentially
+ * between attempts. A waiter which has backed off for long yields its cpu, so a preempted owner can finish.
+ * Suits locks which are held for a few instructions, like the node locks of a list.
+ */
+class SpinLock {
+    static const unsigned int MAX_BACKOFF = 1024;
+    std::atomic<uint8_t> locked;
+
+    static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+public:
+    SpinLock() : locked(0) {}
+    SpinLock(const SpinLock&) = delete;
+    SpinLock& operator=(const SpinLock&) = delete;
+
+    void lock() {
+        unsigned int backoff = 1;
+        while(locked.exchange(1, std::memory_order_acquire) != 0){
+            do {
+                if(backoff < MAX_BACKOFF){
+                    for(unsigned int i = 0; i < backoff; ++i){
+                        pause();
+                    }
+                    backoff *= 2;
+                } else {
+                    sched_yield();
+                }
+            } while(locked.load(std::memory_order_relaxed) != 0);
+        }
+    }
+    void unlock() {
+        locked.store(0, std::memory_order_release);
+    }
+};
+
+#endif //LOCKS_H_
@@ -0,0 +1,322 @@
+#ifndef NODE_POOL_H_
+#define NODE_POOL_H_
+
+#include <pthread.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Node allocators of List (ThreadSafeList.h). An allocator is instantiated with the list's Node type and provides
+ * Node* create(data, next) and void destroy(Node*). Node must have the public members data and next.
+ */
+
+/**
+ * Allocates every node with new and frees it with delete
+ */
+template <typename Node>
+class NewNodeAllocator {
+public:
+    template <typename Data>
+    Node* create(Data&& data, Node* next) {
+        return new Node(std::forward<Data>(data), next);
+    }
+
+    void destroy(Node* node) {
+        delete node;
+    }
+};
+
+/**
+ * Recycles the nodes of a single list, so a node is constructed (and its lock initialized) only the first time
+ * its memory is used, and destroyed only with the pool. A recycled node gets its new data by assignment, so the
+ * data of a freed node lives on until the node is reused or the pool is destroyed.
+ * Like memory_pool (memory_pool.h), nodes are carved from chunks which are allocated on demand and free nodes
+ * are kept in intrusive LIFO lists, linked through their next member. Every thread keeps a cache of free nodes
+ * of each pool, so most creates and destroys take no lock. Whole batches move between the caches and a
+ * shared list protected by a mutex.
+ */
+template <typename Node>
+class PooledNodeAllocator {
+    //nodes moved between a thread's cache and the shared list at once, a cache holds up to twice as many.
+    //also the number of never used slots a thread carves from a chunk at once
+    static const unsigned int BATCH = 32;
+    static const size_t FIRST_CHUNK_NODES = 64;
+    static const size_t MAX_CHUNK_NODES = 64 * 1024;
+
+    struct Chunk {
+        Chunk* next;
+        size_t capacity;
+        //slots which have been carved, they hold constructed nodes unless they're in some raw range
+        size_t used;
+        Node* slots() {
+            return reinterpret_cast<Node*>(reinterpret_cast<char*>(this) + slotsOffset());
+        }
+    };
+
+    //carved slots left unconstructed by a thread which exited, the header lies in the first slot of the range
+    struct RawRange {
+        RawRange* next;
+        Node* end;
+    };
+    static_assert(sizeof(RawRange) <= sizeof(Node) && alignof(RawRange) <= alignof(Node),
+            "a raw range header must fit in a slot");
+
+    struct Cache {
+        PooledNodeAllocator* pool;
+        Node* free_nodes;
+        unsigned int count;
+        //carved slots which haven't been constructed yet, create() takes them from raw up to raw_end
+        Node* raw;
+        Node* raw_end;
+        //all the caches of the pool, so they can be freed with it
+        Cache* next;
+        Cache* prev;
+    };
+
+    pthread_key_t key;
+    //false if the process ran out of keys, every create and destroy then goes through the shared list
+    bool has_key;
+    //protects everything below
+    pthread_mutex_t lock;
+    Node* free_nodes;
+    RawRange* raw_ranges;
+    Chunk* chunks;
+    Cache* caches;
+
+    static constexpr size_t slotsOffset() {
+        return (sizeof(Chunk) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+    }
+
+    static void pushAll(Node*& list, Node* first, Node* last) {
+        last->next = list;
+        list = first;
+    }
+
+    //called when a thread exits, its free nodes and raw slots go back to the shared lists
+    static void cacheDestroy(void* ptr) {
+        Cache* cache = static_cast<Cache*>(ptr);
+        PooledNodeAllocator* pool = cache->pool;
+        pthread_mutex_lock(&pool->lock);
+        Node* last = cache->free_nodes;
+        while(last != nullptr && last->next != nullptr){
+            last = last->next;
+        }
+        if(last != nullptr){
+            pushAll(pool->free_nodes, cache->free_nodes, last);
+        }
+        if(cache->raw != cache->raw_end){
+            RawRange* range = reinterpret_cast<RawRange*>(cache->raw);
+            range->end = cache->raw_end;
+            range->next = pool->raw_ranges;
+            pool->raw_ranges = range;
+        }
+        if(cache->prev != nullptr){
+            cache->prev->next = cache->next;
+        } else {
+            pool->caches = cache->next;
+        }
+        if(cache->next != nullptr){
+            cache->next->prev = cache->prev;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        delete cache;
+    }
+
+    /**
+     * @return the calling thread's cache, nullptr if the pool has no key
+     */
+    Cache* threadCache() {
+        if(!has_key){
+            return nullptr;
+        }
+        Cache* cache = static_cast<Cache*>(pthread_getspecific(key));
+        if(cache != nullptr){
+            return cache;
+        }
+        cache = new Cache{this, nullptr, 0, nullptr, nullptr, nullptr, nullptr};
+        pthread_mutex_lock(&lock);
+        cache->next = caches;
+        if(caches != nullptr){
+            caches->prev = cache;
+        }
+        caches = cache;
+        pthread_mutex_unlock(&lock);
+        pthread_setspecific(key, cache);
+        return cache;
+    }
+
+    /**
+     * Carves up to @param max_slots never used slots from the newest chunk, allocating a chunk if it's full.
+     * the lock must be held
+     * @return the first slot, the slots up to @param end are carved
+     */
+    Node* carve(size_t max_slots, Node*& end) {
+        if(chunks == nullptr || chunks->used == chunks->capacity){
+            size_t capacity = chunks == nullptr ? FIRST_CHUNK_NODES
+                    : (chunks->capacity * 2 < MAX_CHUNK_NODES ? chunks->capacity * 2 : MAX_CHUNK_NODES);
+            Chunk* chunk = static_cast<Chunk*>(::operator new(slotsOffset() + capacity * sizeof(Node)));
+            chunk->next = chunks;
+            chunk->capacity = capacity;
+            chunk->used = 0;
+            chunks = chunk;
+        }
+        size_t count = chunks->capacity - chunks->used < max_slots ? chunks->capacity - chunks->used : max_slots;
+        Node* first = chunks->slots() + chunks->used;
+        chunks->used += count;
+        end = first + count;
+        return first;
+    }
+
+    /**
+     * Fills @param cache, which is empty, with up to BATCH free nodes from the shared list,
+     * or if there are none with raw slots: a range left by an exited thread or a batch carved from a chunk
+     */
+    void refill(Cache* cache) {
+        pthread_mutex_lock(&lock);
+        if(free_nodes != nullptr){
+            Node* last = free_nodes;
+            unsigned int count = 1;
+            while(count < BATCH && last->next != nullptr){
+                last = last->next;
+                ++count;
+            }
+            cache->free_nodes = free_nodes;
+            free_nodes = last->next;
+            last->next = nullptr;
+            cache->count = count;
+        } else if(raw_ranges != nullptr){
+            RawRange* range = raw_ranges;
+            raw_ranges = range->next;
+            cache->raw_end = range->end;
+            cache->raw = reinterpret_cast<Node*>(range);
+        } else {
+            cache->raw = carve(BATCH, cache->raw_end);
+        }
+        pthread_mutex_unlock(&lock);
+    }
+
+    //the slow path of a pool without a key, one node at a time under the lock
+    template <typename Data>
+    Node* createShared(Data&& data, Node* next) {
+        pthread_mutex_lock(&lock);
+        Node* node = free_nodes;
+        if(node != nullptr){
+            free_nodes = node->next;
+            pthread_mutex_unlock(&lock);
+            node->data = std::forward<Data>(data);
+            node->next = next;
+            return node;
+        }
+        Node* end;
+        Node* slot = carve(1, end);
+        pthread_mutex_unlock(&lock);
+        return new (slot) Node(std::forward<Data>(data), next);
+    }
+
+public:
+    PooledNodeAllocator() : free_nodes(nullptr), raw_ranges(nullptr), chunks(nullptr), caches(nullptr) {
+        //there are only PTHREAD_KEYS_MAX keys per process, many pools may use them all
+        has_key = pthread_key_create(&key, cacheDestroy) == 0;
+        pthread_mutex_init(&lock, nullptr);
+    }
+
+    /**
+     * Destroys all the nodes, every node created by the pool must have been given back to it already,
+     * and no other thread may use the pool anymore
+     */
+    ~PooledNodeAllocator() {
+        if(has_key){
+            pthread_key_delete(key);
+        }
+        //slots of the raw ranges were carved but never constructed
+        std::vector<std::pair<Node*, Node*>> raw;
+        while(caches != nullptr){
+            Cache* next = caches->next;
+            if(caches->raw != caches->raw_end){
+                raw.emplace_back(caches->raw, caches->raw_end);
+            }
+            delete caches;
+            caches = next;
+        }
+        for(RawRange* range = raw_ranges; range != nullptr; range = range->next){
+            raw.emplace_back(reinterpret_cast<Node*>(range), range->end);
+        }
+        std::sort(raw.begin(), raw.end());
+        while(chunks != nullptr){
+            Chunk* next = chunks->next;
+            for(Node* slot = chunks->slots(); slot != chunks->slots() + chunks->used; ++slot){
+                auto it = std::upper_bound(raw.begin(), raw.end(), slot,
+                        [](Node* slot, const std::pair<Node*, Node*>& range) { return slot < range.first; });
+                if(it != raw.begin() && slot < std::prev(it)->second){
+                    //skip the rest of the range
+                    slot = std::prev(it)->second - 1;
+                    continue;
+                }
+                slot->~Node();
+            }
+            ::operator delete(chunks);
+            chunks = next;
+        }
+        pthread_mutex_destroy(&lock);
+    }
+
+    PooledNodeAllocator(const PooledNodeAllocator&) = delete;
+    PooledNodeAllocator& operator=(const PooledNodeAllocator&) = delete;
+
+    template <typename Data>
+    Node* create(Data&& data, Node* next) {
+        Cache* cache = threadCache();
+        if(cache == nullptr){
+            return createShared(std::forward<Data>(data), next);
+        }
+        if(cache->free_nodes == nullptr && cache->raw == cache->raw_end){
+            refill(cache);
+        }
+        if(cache->free_nodes == nullptr){
+            return new (cache->raw++) Node(std::forward<Data>(data), next);
+        }
+        Node* node = cache->free_nodes;
+        cache->free_nodes = node->next;
+        --cache->count;
+        node->data = std::forward<Data>(data);
+        node->next = next;
+        return node;
+    }
+
+    void destroy(Node* node) {
+        Cache* cache = threadCache();
+        if(cache == nullptr){
+            pthread_mutex_lock(&lock);
+            node->next = free_nodes;
+            free_nodes = node;
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        node->next = cache->free_nodes;
+        cache->free_nodes = node;
+        if(++cache->count < 2 * BATCH){
+            return;
+        }
+        //keep the newest BATCH nodes, they're the most likely to be in our cache lines
+        Node* last = cache->free_nodes;
+        for(unsigned int i = 1; i < BATCH; ++i){
+            last = last->next;
+        }
+        Node* first = last->next;
+        last->next = nullptr;
+        cache->count = BATCH;
+        Node* tail = first;
+        while(tail->next != nullptr){
+            tail = tail->next;
+        }
+        pthread_mutex_lock(&lock);
+        pushAll(free_nodes, first, tail);
+        pthread_mutex_unlock(&lock);
+    }
+};
+
+#endif //NODE_POOL_H_
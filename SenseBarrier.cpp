@@ -0,0 +1,18 @@
+#include "Futex.h"
+#include "SenseBarrier.h"
+
+SenseBarrier::SenseBarrier(unsigned int num_of_threads) : num_of_threads(num_of_threads), waiting_threads(0)
+        , phase(0), sleeping_threads(0), spin_limit(defaultSpinLimit()) {
+}
+
+void SenseBarrier::wait() {
+    //read before arriving, the phase can't move on before we arrive
+    unsigned int my_phase = phase.load(std::memory_order_acquire);
+    if(waiting_threads.fetch_add(1, std::memory_order_acq_rel) + 1 == num_of_threads){
+        //reset before releasing anyone, so the threads of the next phase count from 0
+        waiting_threads.store(0, std::memory_order_relaxed);
+        storeAndWake(phase, my_phase + 1, sleeping_threads);
+        return;
+    }
+    waitUntil(phase, my_phase + 1, sleeping_threads, spin_limit);
+}
@@ -0,0 +1,30 @@
+#ifndef SENSE_BARRIER_H_
+#define SENSE_BARRIER_H_
+
+#include <atomic>
+
+/**
+ * A drop-in replacement of Barrier (Barrier.h) built on a single atomic counter.
+ * Every phase has a number (its sense), the last thread to arrive resets the counter and moves to the next phase,
+ * which releases everyone who waits on the current one. While all the threads are on a cpu a phase costs one
+ * atomic increment per thread and no system calls. A waiter spins for a short while and then sleeps on a futex,
+ * the last arriver enters the kernel to wake it only if someone went to sleep.
+ */
+class SenseBarrier {
+    const unsigned int num_of_threads;
+    //threads which arrived in the current phase
+    std::atomic<unsigned int> waiting_threads;
+    //the number of the current phase, also the futex word
+    std::atomic<unsigned int> phase;
+    //threads which gave up spinning and may sleep on phase
+    std::atomic<unsigned int> sleeping_threads;
+    //how many times a waiter checks the phase before it goes to sleep, 0 on a single cpu
+    const unsigned int spin_limit;
+public:
+    explicit SenseBarrier(unsigned int num_of_threads);
+    void wait();
+    ~SenseBarrier() = default;
+
+};
+
+#endif // SENSE_BARRIER_H_
@@ -0,0 +1,189 @@
+#ifndef SHARDED_LIST_H_
+#define SHARDED_LIST_H_
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <iostream>
+#include <iomanip> // std::setw
+#include "ThreadSafeList.h"
+
+/**
+ * A sorted set which splits the key space into ranges, each kept in a List (ThreadSafeList.h) of its own.
+ * Operations on different shards never touch the same lock, so throughput grows with the number of shards
+ * as long as the keys spread over them.
+ * The routing table (the lowest key of every shard but the first) is fixed at construction and only read
+ * afterwards, so routing takes no locks. Since the shards are ordered ranges, visiting them one after the other
+ * visits all the keys in ascending order.
+ * T must support operator< and operator==.
+ */
+template <typename T, template <typename> class Allocator = PooledNodeAllocator, typename Lock = MutexLock>
+class ShardedList
+{
+    public:
+        typedef List<T, Allocator, Lock> Shard;
+
+        /**
+         * Constructor
+         * @param bounds shard i holds the keys in [bounds[i-1], bounds[i]), the first and last shards are
+         * unbounded below and above, so there are bounds.size()+1 shards
+         */
+        explicit ShardedList(std::vector<T> bounds_in) : bounds(std::move(bounds_in)) {
+            std::sort(bounds.begin(), bounds.end());
+            bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+            for(size_t i = 0; i <= bounds.size(); ++i){
+                shards.emplace_back(new Shard());
+            }
+        }
+
+        /**
+         * Constructor for arithmetic keys, splits [@param min, @param max) into @param num_shards equal ranges.
+         * An integer range narrower than num_shards gets one shard per key
+         */
+        ShardedList(unsigned int num_shards, const T& min, const T& max)
+                : ShardedList(evenBounds(num_shards, min, max)) {}
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            if(!shards[shardOf(data)]->insert(data)){
+                return false;
+            }
+            __insert_test_hook();
+            return true;
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            if(!shards[shardOf(value)]->remove(value)){
+                return false;
+            }
+            __remove_test_hook();
+            return true;
+        }
+
+        /**
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            return shards[shardOf(value)]->contains(value);
+        }
+
+        /**
+         * Returns the current size of the list, the sum of the shards' sizes. Under concurrent updates it's
+         * a sum of sizes which were each exact at some point during the call
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            unsigned int size = 0;
+            for(auto& shard : shards){
+                size += shard->getSize();
+            }
+            return size;
+        }
+
+        unsigned int numShards() const {
+            return shards.size();
+        }
+
+        /**
+         * @return the size of shard @param i, the shard of the i-th range
+         */
+        unsigned int shardSize(unsigned int i) {
+            return shards[i]->getSize();
+        }
+
+        /**
+         * @return the index of the shard which holds @param key
+         */
+        unsigned int shardOf(const T& key) const {
+            return std::upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin();
+        }
+
+        /**
+         * Calls @param visitor with every key in ascending order, one shard after the other.
+         * The visitor runs while a node is locked, so it must not use the list
+         * @param visitor called as visitor(const T&)
+         */
+        template <typename Visitor>
+        void forEach(Visitor visitor) {
+            for(auto& shard : shards){
+                shard->forEach(visitor);
+            }
+        }
+
+        /**
+         * Calls @param visitor with every key in [@param lo, @param hi) in ascending order, visiting only the
+         * shards which overlap the range
+         * @param visitor called as visitor(const T&)
+         */
+        template <typename Visitor>
+        void range(const T& lo, const T& hi, Visitor visitor) {
+            if(!(lo < hi)){
+                return;
+            }
+            for(unsigned int i = shardOf(lo), last = shardOf(hi); i <= last && i < shards.size(); ++i){
+                shards[i]->range(lo, hi, visitor);
+            }
+        }
+
+		// Don't remove
+        void print() {
+          forEach([](const T& data){ std::cout << std::right << std::setw(3) << data << " "; });
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+        virtual ~ShardedList() = default;
+
+private:
+    std::vector<T> bounds;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    static std::vector<T> evenBounds(unsigned int num_shards, const T& min, const T& max) {
+        std::vector<T> result;
+        //a single shard (or none) needs no bounds
+        if(num_shards <= 1 || !(min < max)){
+            return result;
+        }
+        if constexpr (std::is_integral<T>::value) {
+            //the width of the range may not fit in T (e.g. INT_MIN..INT_MAX), but it always fits in unsigned T
+            typedef typename std::make_unsigned<T>::type U;
+            U width = (U)max - (U)min;
+            //every shard gets at least one key
+            if(width < num_shards){
+                num_shards = width;
+            }
+            U step = width / num_shards;
+            U remainder = width % num_shards;
+            for(unsigned int i = 1; i < num_shards; ++i){
+                //remainder * i < num_shards^2, which fits in 64 bits
+                U offset = step * i + (U)((unsigned long long)remainder * i / num_shards);
+                result.push_back((T)((U)min + offset));
+            }
+        } else {
+            //weighted, so max - min can't overflow
+            for(unsigned int i = 1; i < num_shards; ++i){
+                long double weight = (long double)i / num_shards;
+                result.push_back((T)(min * (1 - weight) + max * weight));
+            }
+        }
+        return result;
+    }
+};
+
+#endif //SHARDED_LIST_H_
@@ -0,0 +1,317 @@
+#ifndef SKIP_LIST_H_
+#define SKIP_LIST_H_
+
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <iomanip> // std::setw
+#include "EpochReclaimer.h"
+
+/**
+ * A concurrent sorted set with O(log n) expected operations (the lazy skip list of Herlihy, Lev, Luchangco and Shavit).
+ * Lookups and range iteration take no locks. insert and remove find their position without locks, then lock only
+ * the predecessors they change (and the removed node), validate them and retry if another thread got in the way.
+ * A node is logically in the set once it's linked at all of its levels and until it's marked.
+ * Removed nodes are deleted through EpochReclaimer.
+ * T must support operator< and operator==.
+ */
+template <typename T>
+class SkipList
+{
+    public:
+        static const int MAX_LEVEL = 32;
+
+        /**
+         * The part of a node the traversals need, the head of the list is a bare Link
+         */
+        class Link {
+         public:
+          //next[i] is the next node at level i, for every i <= top_level
+          std::atomic<Link*>* next;
+          int top_level;
+          pthread_mutex_t m;
+          std::atomic<bool> marked;
+          std::atomic<bool> fully_linked;
+          explicit Link(int top_level_in) : next(new std::atomic<Link*>[top_level_in + 1]), top_level(top_level_in)
+                  , m(PTHREAD_MUTEX_INITIALIZER), marked(false), fully_linked(false) {
+              for(int i = 0; i <= top_level; ++i){
+                  next[i].store(nullptr, std::memory_order_relaxed);
+              }
+          }
+          virtual ~Link() {
+              pthread_mutex_destroy(&m);
+              delete[] next;
+          }
+        };
+
+        class Node : public Link {
+         public:
+          T data;
+          Node(const T& data_in, int top_level_in) : Link(top_level_in), data(data_in) {}
+        };
+
+        /**
+         * Constructor
+         */
+        SkipList() : head(MAX_LEVEL - 1), counter(0) {
+            head.fully_linked.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * Destructor, no other thread may use the list anymore
+         */
+        virtual ~SkipList() {
+            Link* node = head.next[0].load(std::memory_order_relaxed);
+            while(node != nullptr){
+                Link* tmp = node;
+                node = node->next[0].load(std::memory_order_relaxed);
+                delete tmp;
+            }
+        }
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            EpochReclaimer::Guard guard;
+            //built before any lock is taken, nobody can see it until it's linked
+            Node* node = new Node(data, randomLevel());
+            int top_level = node->top_level;
+            Link* preds[MAX_LEVEL];
+            Link* succs[MAX_LEVEL];
+            while(true){
+                int found = find(data, preds, succs);
+                if(found != -1){
+                    Link* other = succs[found];
+                    if(!other->marked.load(std::memory_order_acquire)){
+                        //it's being inserted, wait until it's in the set so we don't return before it's there
+                        while(!other->fully_linked.load(std::memory_order_acquire)){}
+                        delete node;
+                        return false;
+                    }
+                    //it's being removed, try again once it's gone
+                    continue;
+                }
+                int locked;
+                if(!lockPreds(preds, succs, top_level, nullptr, locked)){
+                    unlockPreds(preds, locked);
+                    continue;
+                }
+                for(int level = 0; level <= top_level; ++level){
+                    node->next[level].store(succs[level], std::memory_order_relaxed);
+                }
+                for(int level = 0; level <= top_level; ++level){
+                    preds[level]->next[level].store(node, std::memory_order_release);
+                }
+                node->fully_linked.store(true, std::memory_order_release);
+                unlockPreds(preds, top_level);
+                counter.fetch_add(1, std::memory_order_relaxed);
+                __insert_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            EpochReclaimer::Guard guard;
+            Link* victim = nullptr;
+            Link* preds[MAX_LEVEL];
+            Link* succs[MAX_LEVEL];
+            while(true){
+                int found = find(value, preds, succs);
+                if(victim == nullptr){
+                    //a node which is still being inserted or found below its top level isn't ours to remove yet
+                    if(found == -1 || !succs[found]->fully_linked.load(std::memory_order_acquire)
+                            || succs[found]->top_level != found || succs[found]->marked.load(std::memory_order_acquire)){
+                        return false;
+                    }
+                    victim = succs[found];
+                    pthread_mutex_lock(&victim->m);
+                    if(victim->marked.load(std::memory_order_relaxed)){
+                        pthread_mutex_unlock(&victim->m);
+                        return false;
+                    }
+                    //from here the node is out of the set, and we're the only ones to unlink it
+                    victim->marked.store(true, std::memory_order_release);
+                }
+                int top_level = victim->top_level;
+                int locked;
+                if(!lockPreds(preds, succs, top_level, victim, locked)){
+                    unlockPreds(preds, locked);
+                    continue;
+                }
+                for(int level = top_level; level >= 0; --level){
+                    preds[level]->next[level].store(victim->next[level].load(std::memory_order_relaxed), std::memory_order_release);
+                }
+                pthread_mutex_unlock(&victim->m);
+                unlockPreds(preds, top_level);
+                EpochReclaimer::retire(victim);
+                counter.fetch_sub(1, std::memory_order_relaxed);
+                __remove_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Wait-free lookup
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            EpochReclaimer::Guard guard;
+            Link* preds[MAX_LEVEL];
+            Link* succs[MAX_LEVEL];
+            int found = find(value, preds, succs);
+            return found != -1 && succs[found]->fully_linked.load(std::memory_order_acquire)
+                    && !succs[found]->marked.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Calls @param visitor with the data of every node in [@param lo, @param hi) in ascending order, without locking.
+         * Nodes which are inserted or removed during the iteration may or may not be visited
+         * @param visitor called as visitor(const T&)
+         */
+        template <typename Visitor>
+        void range(const T& lo, const T& hi, Visitor visitor) {
+            EpochReclaimer::Guard guard;
+            Link* pred = &head;
+            for(int level = MAX_LEVEL - 1; level >= 0; --level){
+                Link* curr = pred->next[level].load(std::memory_order_acquire);
+                while(curr != nullptr && data(curr) < lo){
+                    pred = curr;
+                    curr = pred->next[level].load(std::memory_order_acquire);
+                }
+            }
+            Link* curr = pred->next[0].load(std::memory_order_acquire);
+            while(curr != nullptr && data(curr) < hi){
+                if(curr->fully_linked.load(std::memory_order_acquire) && !curr->marked.load(std::memory_order_acquire)){
+                    visitor(data(curr));
+                }
+                curr = curr->next[0].load(std::memory_order_acquire);
+            }
+        }
+
+        /**
+         * Returns the current size of the list
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            return counter.load(std::memory_order_relaxed);
+        }
+
+		// Don't remove
+        void print() {
+          EpochReclaimer::Guard guard;
+          Link* temp = head.next[0].load(std::memory_order_acquire);
+          while (temp != nullptr)
+          {
+            if (!temp->marked.load(std::memory_order_acquire))
+            {
+              std::cout << std::right << std::setw(3) << data(temp) << " ";
+            }
+            temp = temp->next[0].load(std::memory_order_acquire);
+          }
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+private:
+    Link head;
+    std::atomic<int> counter;
+
+    static const T& data(Link* link) {
+        return static_cast<Node*>(link)->data;
+    }
+
+    /**
+     * Each level holds about half of the nodes of the level below it
+     * @return the top level of a new node
+     */
+    static int randomLevel() {
+        static thread_local uint64_t state = 0;
+        if(state == 0){
+            state = reinterpret_cast<uintptr_t>(&state) | 1;
+        }
+        //xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int level = __builtin_ctzll(state | (uint64_t(1) << (MAX_LEVEL - 1)));
+        return level;
+    }
+
+    /**
+     * Finds the predecessor and successor of @param key at every level, without locking
+     * @param preds set to the last node at each level whose data is smaller than @param key
+     * @param succs set to the node after preds[i] at each level
+     * @return the highest level at which a node with the same data was found, -1 if none
+     */
+    int find(const T& key, Link** preds, Link** succs) {
+        int found = -1;
+        Link* pred = &head;
+        for(int level = MAX_LEVEL - 1; level >= 0; --level){
+            Link* curr = pred->next[level].load(std::memory_order_acquire);
+            while(curr != nullptr && data(curr) < key){
+                pred = curr;
+                curr = pred->next[level].load(std::memory_order_acquire);
+            }
+            if(found == -1 && curr != nullptr && data(curr) == key){
+                found = level;
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return found;
+    }
+
+    /**
+     * Locks preds[0..top_level], each once, and checks that nobody changed them since find()
+     * @param victim the node being removed, expected to be succs[i] at every level, nullptr for an insert
+     * @param locked set to the highest level whose pred is locked, the caller unlocks them either way
+     * @return true if all of them are locked and valid
+     */
+    bool lockPreds(Link** preds, Link** succs, int top_level, Link* victim, int& locked) {
+        Link* prev_pred = nullptr;
+        for(int level = 0; level <= top_level; ++level){
+            Link* pred = preds[level];
+            Link* succ = victim != nullptr ? victim : succs[level];
+            if(pred != prev_pred){
+                pthread_mutex_lock(&pred->m);
+                prev_pred = pred;
+            }
+            locked = level;
+            bool valid = !pred->marked.load(std::memory_order_acquire)
+                    && pred->next[level].load(std::memory_order_acquire) == succ
+                    && (victim != nullptr || succ == nullptr || !succ->marked.load(std::memory_order_acquire));
+            if(!valid){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //unlocks the preds locked by lockPreds(), up to @param top_level
+    static void unlockPreds(Link** preds, int top_level) {
+        Link* prev_pred = nullptr;
+        for(int level = 0; level <= top_level; ++level){
+            if(preds[level] != prev_pred){
+                pthread_mutex_unlock(&preds[level]->m);
+                prev_pred = preds[level];
+            }
+        }
+    }
+};
+
+#endif //SKIP_LIST_H_
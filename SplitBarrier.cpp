@@ -0,0 +1,45 @@
+#include "Futex.h"
+#include "SplitBarrier.h"
+
+SplitBarrier::SplitBarrier(unsigned int num_of_threads, std::function<void()> completion)
+        : expected_threads(num_of_threads), arrived_threads(0), dropped_threads(0), phase(0), sleeping_threads(0)
+        , spin_limit(defaultSpinLimit()), completion(std::move(completion)) {
+}
+
+void SplitBarrier::arriveAt(unsigned int my_phase) {
+    //read before arriving: it changes only when the phase completes, which can't happen before we arrive.
+    //read after, a thread delayed here could see the next phase's count and complete the phase again
+    unsigned int expected = expected_threads.load(std::memory_order_relaxed);
+    if(arrived_threads.fetch_add(1, std::memory_order_acq_rel) + 1 != expected){
+        return;
+    }
+    //everyone arrived, nobody can touch the counters before the phase moves on
+    expected_threads.fetch_sub(dropped_threads.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    arrived_threads.store(0, std::memory_order_relaxed);
+    if(completion){
+        completion();
+    }
+    storeAndWake(phase, my_phase + 1, sleeping_threads);
+}
+
+SplitBarrier::Token SplitBarrier::arrive() {
+    //read before arriving, the phase can't move on before we arrive
+    unsigned int my_phase = phase.load(std::memory_order_acquire);
+    arriveAt(my_phase);
+    return Token(my_phase);
+}
+
+void SplitBarrier::wait(Token token) {
+    waitUntil(phase, token.phase + 1, sleeping_threads, spin_limit);
+}
+
+void SplitBarrier::wait() {
+    wait(arrive());
+}
+
+void SplitBarrier::arriveAndDrop() {
+    unsigned int my_phase = phase.load(std::memory_order_acquire);
+    //counted before arriving, so the last arriver of this phase sees it
+    dropped_threads.fetch_add(1, std::memory_order_relaxed);
+    arriveAt(my_phase);
+}
@@ -0,0 +1,71 @@
+#ifndef SPLIT_BARRIER_H_
+#define SPLIT_BARRIER_H_
+
+#include <atomic>
+#include <functional>
+
+/**
+ * A split-phase barrier: arriving and waiting are separate calls, so a thread can do work which doesn't
+ * depend on the others between them.
+ *     SplitBarrier::Token token = barrier.arrive();
+ *     ...local work...
+ *     barrier.wait(token);
+ * A thread arrives once per phase and must wait for its token before it arrives again.
+ * The completion function, if given, runs once per phase on the last thread to arrive, after everyone arrived
+ * and before anyone is released, so it can combine the results of the phase (e.g. a reduction).
+ * Threads which leave the group call arriveAndDrop(), which counts as their arrival at the current phase
+ * and lowers the number of threads the next phases wait for.
+ */
+class SplitBarrier {
+    //threads the current phase waits for
+    std::atomic<unsigned int> expected_threads;
+    //threads which arrived in the current phase
+    std::atomic<unsigned int> arrived_threads;
+    //threads which dropped in the current phase, taken off expected_threads when it completes
+    std::atomic<unsigned int> dropped_threads;
+    //the number of the current phase, also the futex word
+    std::atomic<unsigned int> phase;
+    //threads which gave up spinning and may sleep on phase
+    std::atomic<unsigned int> sleeping_threads;
+    const unsigned int spin_limit;
+    const std::function<void()> completion;
+
+    void arriveAt(unsigned int my_phase);
+public:
+    class Token {
+        unsigned int phase;
+        explicit Token(unsigned int phase) : phase(phase) {}
+        friend class SplitBarrier;
+    };
+
+    /**
+     * @param num_of_threads number of threads which arrive at the first phase
+     * @param completion called by the last arriver of every phase, may be empty
+     */
+    explicit SplitBarrier(unsigned int num_of_threads, std::function<void()> completion = nullptr);
+
+    /**
+     * counts the calling thread as arrived at the current phase, doesn't block.
+     * @return token of the phase, to pass to wait
+     */
+    Token arrive();
+
+    /**
+     * blocks until the phase of token completes, returns at once if it already did.
+     * @param token returned by arrive
+     */
+    void wait(Token token);
+
+    //arrive() and then wait(), the same as Barrier::wait
+    void wait();
+
+    /**
+     * arrives at the current phase and leaves the group, doesn't block.
+     */
+    void arriveAndDrop();
+
+    ~SplitBarrier() = default;
+
+};
+
+#endif // SPLIT_BARRIER_H_
@@ -0,0 +1,108 @@
+#ifndef STRIPED_COUNTER_H_
+#define STRIPED_COUNTER_H_
+
+#include <atomic>
+#include <thread>
+
+/**
+ * A counter which many threads update without sharing a cache line (like the kernel's percpu_counter).
+ * Every thread adds to one of several stripes, each on a cache line of its own, and reading the counter sums them.
+ * In the approximate mode (batch > 0) a stripe is folded into a central count whenever it drifts by batch or
+ * more, so read() returns the central count alone: it costs a single load and is off by less than
+ * batch * numStripes(). sum() adds up everything, it's exact in both modes except that a stripe which is being folded
+ * at that very moment may be counted twice.
+ */
+class StripedCounter {
+    struct alignas(64) Stripe {
+        std::atomic<long> value;
+        Stripe() : value(0) {}
+    };
+
+    static const unsigned int MAX_STRIPES = 64;
+
+    Stripe* stripes;
+    //numStripes() - 1, the number of stripes is a power of two
+    unsigned int mask;
+    const long batch;
+    alignas(64) std::atomic<long> central;
+
+    static unsigned int defaultStripes() {
+        unsigned int cpus = std::thread::hardware_concurrency();
+        unsigned int stripes = 1;
+        while(stripes < cpus && stripes < MAX_STRIPES){
+            stripes *= 2;
+        }
+        return stripes;
+    }
+
+    //threads are assigned to stripes round robin on their first update of any counter
+    static unsigned int threadIndex() {
+        static std::atomic<unsigned int> next_index(0);
+        static thread_local unsigned int index = next_index.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+public:
+    /**
+     * Constructor
+     * @param batch 0 for the exact mode, otherwise how far a stripe may drift before it's folded into the central count
+     * @param num_stripes rounded up to a power of two, 0 picks one stripe per cpu (up to 64)
+     */
+    explicit StripedCounter(long batch = 0, unsigned int num_stripes = 0) : batch(batch < 0 ? -batch : batch), central(0) {
+        unsigned int count = 1;
+        unsigned int wanted = num_stripes == 0 ? defaultStripes() : num_stripes;
+        while(count < wanted && count < MAX_STRIPES){
+            count *= 2;
+        }
+        stripes = new Stripe[count];
+        mask = count - 1;
+    }
+
+    ~StripedCounter() {
+        delete[] stripes;
+    }
+
+    StripedCounter(const StripedCounter&) = delete;
+    StripedCounter& operator=(const StripedCounter&) = delete;
+
+    void add(long delta) {
+        std::atomic<long>& value = stripes[threadIndex() & mask].value;
+        long updated = value.fetch_add(delta, std::memory_order_relaxed) + delta;
+        if(batch != 0 && (updated >= batch || updated <= -batch)){
+            //the central count first, so the folded amount is never missing from a sum (only counted twice for a moment)
+            long folded = value.load(std::memory_order_relaxed);
+            central.fetch_add(folded, std::memory_order_relaxed);
+            value.fetch_sub(folded, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Cheap read, a single load in the approximate mode
+     * @return the count, within batch * numStripes() of the exact one in the approximate mode, exact otherwise
+     */
+    long read() const {
+        if(batch == 0){
+            return sum();
+        }
+        return central.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Exact read, it sums all the stripes. Every update which completed before the call is counted, see above
+     * @return the count
+     */
+    long sum() const {
+        long total = 0;
+        //the stripes before the central count, a fold we see in a stripe has already reached the central count
+        for(unsigned int i = 0; i <= mask; ++i){
+            total += stripes[i].value.load(std::memory_order_acquire);
+        }
+        return total + central.load(std::memory_order_relaxed);
+    }
+
+    unsigned int numStripes() const {
+        return mask + 1;
+    }
+};
+
+#endif //STRIPED_COUNTER_H_
@@ -0,0 +1,196 @@
+#include <sched.h>
+#include <system_error>
+#include "Futex.h"
+#include "TaskPool.h"
+
+//attempts to find a task before an idle worker goes to sleep, and before a waiting thread starts yielding
+#define IDLE_ROUNDS 64
+
+struct TaskPool::Worker {
+    TaskPool* pool;
+    unsigned int index;
+    WorkStealingDeque<Task> tasks;
+    pthread_t thread;
+    //picks the victims to steal from
+    uint64_t seed;
+
+    Worker(TaskPool* pool, unsigned int index) : pool(pool), index(index), thread(), seed(index * 2 + 1) {}
+};
+
+//the worker the calling thread runs, nullptr outside of any pool
+static thread_local void* current_worker = nullptr;
+
+TaskPool::TaskPool(unsigned int num_of_workers) : shared_size(0), idle_workers(0), work_epoch(0)
+        , sleeping_workers(0), stopping(false), finished_groups(0), sleeping_waiters(0) {
+    if(num_of_workers == 0){
+        unsigned int cpus = std::thread::hardware_concurrency();
+        num_of_workers = cpus > 1 ? cpus - 1 : 1;
+    }
+    for(unsigned int i = 0; i < num_of_workers; ++i){
+        workers.emplace_back(new Worker(this, i));
+    }
+    for(size_t i = 0; i < workers.size(); ++i){
+        int error = pthread_create(&workers[i]->thread, nullptr, workerMain, workers[i].get());
+        if(error != 0){
+            //there are no tasks yet, so the started workers leave as soon as they see stopping
+            stopping.store(true, std::memory_order_seq_cst);
+            addAndWake(work_epoch, 1, sleeping_workers);
+            for(size_t j = 0; j < i; ++j){
+                pthread_join(workers[j]->thread, nullptr);
+            }
+            throw std::system_error(error, std::generic_category(), "TaskPool: can't start a worker thread");
+        }
+    }
+}
+
+TaskPool::~TaskPool() {
+    stopping.store(true, std::memory_order_seq_cst);
+    addAndWake(work_epoch, 1, sleeping_workers);
+    for(auto& worker : workers){
+        pthread_join(worker->thread, nullptr);
+    }
+    //the workers ran everything they could reach, this picks up whatever a thread outside the pool
+    //spawned after their last look, so every Group still gets to zero
+    while(Task* task = findTask()){
+        execute(task);
+    }
+}
+
+void TaskPool::spawn(Task* task) {
+    Worker* worker = static_cast<Worker*>(current_worker);
+    if(worker != nullptr && worker->pool == this){
+        worker->tasks.push(task);
+    } else {
+        shared_m.lock();
+        shared_tasks.push_back(task);
+        shared_size.fetch_add(1, std::memory_order_relaxed);
+        shared_m.unlock();
+    }
+    //pairs with the idle_workers increment: either the worker's last search finds the task or we wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(idle_workers.load(std::memory_order_relaxed) != 0){
+        addAndWake(work_epoch, 1, sleeping_workers);
+    }
+}
+
+bool TaskPool::localQueueEmpty() {
+    Worker* worker = static_cast<Worker*>(current_worker);
+    if(worker != nullptr && worker->pool == this){
+        return worker->tasks.empty();
+    }
+    return shared_size.load(std::memory_order_relaxed) == 0;
+}
+
+TaskPool::Task* TaskPool::findTask() {
+    Worker* self = static_cast<Worker*>(current_worker);
+    if(self != nullptr && self->pool != this){
+        self = nullptr;
+    }
+    if(self != nullptr){
+        Task* task = self->tasks.pop();
+        if(task != nullptr){
+            return task;
+        }
+    }
+    if(shared_size.load(std::memory_order_seq_cst) != 0){
+        Task* task = nullptr;
+        shared_m.lock();
+        if(!shared_tasks.empty()){
+            task = shared_tasks.front();
+            shared_tasks.pop_front();
+            shared_size.fetch_sub(1, std::memory_order_relaxed);
+        }
+        shared_m.unlock();
+        if(task != nullptr){
+            return task;
+        }
+    }
+    size_t num_of_workers = workers.size();
+    size_t start = 0;
+    if(self != nullptr){
+        //xorshift, the victims differ between the thieves and between the attempts
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 7;
+        self->seed ^= self->seed << 17;
+        start = self->seed % num_of_workers;
+    }
+    for(size_t i = 0; i < num_of_workers; ++i){
+        Worker* victim = workers[(start + i) % num_of_workers].get();
+        if(victim == self){
+            continue;
+        }
+        Task* task = victim->tasks.steal();
+        if(task != nullptr){
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void TaskPool::execute(Task* task) {
+    Group* group = task->group;
+    task->run();
+    delete task;
+    if(group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        //the group's waiter may have destroyed it already, only the pool is touched from here on
+        addAndWake(finished_groups, 1, sleeping_waiters);
+    }
+}
+
+void* TaskPool::workerMain(void* arg) {
+    Worker* self = static_cast<Worker*>(arg);
+    TaskPool* pool = self->pool;
+    current_worker = self;
+    while(true){
+        Task* task = nullptr;
+        for(unsigned int i = 0; i < IDLE_ROUNDS && task == nullptr; ++i){
+            task = pool->findTask();
+            if(task == nullptr){
+                cpuRelax();
+            }
+        }
+        //on shutdown a worker leaves only once it finds no more work, so no spawned task is left behind
+        if(task == nullptr && pool->stopping.load(std::memory_order_acquire)){
+            break;
+        }
+        if(task == nullptr){
+            pool->idle_workers.fetch_add(1, std::memory_order_seq_cst);
+            unsigned int epoch = pool->work_epoch.load(std::memory_order_seq_cst);
+            task = pool->findTask();
+            if(task == nullptr && !pool->stopping.load(std::memory_order_seq_cst)){
+                waitUntil(pool->work_epoch, epoch + 1, pool->sleeping_workers, 0);
+            }
+            pool->idle_workers.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if(task != nullptr){
+            pool->execute(task);
+        }
+    }
+    current_worker = nullptr;
+    return nullptr;
+}
+
+void TaskPool::Group::wait() {
+    Worker* worker = static_cast<Worker*>(current_worker);
+    //a worker keeps looking for tasks, the tasks it's waiting for may spawn more
+    bool outside = worker == nullptr || worker->pool != &pool;
+    unsigned int rounds = 0;
+    while(pending.load(std::memory_order_acquire) != 0){
+        Task* task = pool.findTask();
+        if(task != nullptr){
+            pool.execute(task);
+            rounds = 0;
+        } else if(++rounds < IDLE_ROUNDS){
+            cpuRelax();
+        } else if(!outside){
+            sched_yield();
+        } else {
+            //read before the last check, so if our group finishes after it the counter moves past what we wait for
+            unsigned int finished = pool.finished_groups.load(std::memory_order_seq_cst);
+            if(pending.load(std::memory_order_seq_cst) != 0){
+                waitUntil(pool.finished_groups, finished + 1, pool.sleeping_waiters, 0);
+            }
+            rounds = 0;
+        }
+    }
+}
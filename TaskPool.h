@@ -0,0 +1,170 @@
+#ifndef TASK_POOL_H_
+#define TASK_POOL_H_
+
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Locks.h"
+#include "WorkStealingDeque.h"
+
+/**
+ * A pool of worker threads which run tasks, each worker keeps its tasks in a work-stealing deque
+ * (WorkStealingDeque.h) and an idle worker steals from the others before it goes to sleep.
+ * Tasks are spawned into a Group, and Group::wait() is the barrier which ends a phase: the waiting thread runs
+ * tasks (of any group) until all the tasks of its group finished. A worker keeps looking for tasks meanwhile,
+ * a thread outside the pool sleeps once it finds none until some group finishes.
+ *     TaskPool pool;
+ *     pool.parallelFor(0, n, [&](long i) { out[i] = f(in[i]); });
+ * Threads outside the pool may spawn and wait too, their tasks go to a shared queue.
+ */
+class TaskPool {
+public:
+    class Group;
+
+private:
+    struct Task {
+        Group* group;
+        explicit Task(Group* group) : group(group) {}
+        virtual ~Task() = default;
+        virtual void run() = 0;
+    };
+
+    template <typename Function>
+    struct FunctionTask : Task {
+        Function function;
+        FunctionTask(Group* group, Function&& function) : Task(group), function(std::move(function)) {}
+        void run() override {
+            function();
+        }
+    };
+
+    template <typename Body>
+    struct RangeTask;
+
+    struct Worker;
+
+public:
+    /**
+     * A phase of tasks. wait() (also called by the destructor) returns after every task spawned into the group
+     * finished, including the tasks those spawned.
+     */
+    class Group {
+        TaskPool& pool;
+        std::atomic<unsigned long> pending;
+        friend class TaskPool;
+    public:
+        explicit Group(TaskPool& pool) : pool(pool), pending(0) {}
+        ~Group() {
+            wait();
+        }
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+
+        /**
+         * @param function called with no arguments by some thread of the pool
+         */
+        template <typename Function>
+        void run(Function function) {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            pool.spawn(new FunctionTask<Function>(this, std::move(function)));
+        }
+
+        void wait();
+    };
+
+    /**
+     * @param num_of_workers number of worker threads, 0 for one per cpu but the caller's
+     * @throws std::system_error if a worker thread can't be started, the workers started before it are stopped first
+     */
+    explicit TaskPool(unsigned int num_of_workers = 0);
+    /**
+     * Runs every task which is still queued before it returns, so the groups of the pool all finish.
+     * No thread may spawn into the pool once its destruction started
+     */
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /**
+     * calls body(i) for every i in [begin, end) and returns when all the calls returned.
+     * The range is split lazily: a task splits off half of what it has left only when the deque of its thread
+     * is empty, so idle workers have something to steal, and otherwise runs grain iterations at a time.
+     * @param grain smallest number of iterations worth a task, 0 to pick one from the range and the pool size
+     */
+    template <typename Body>
+    void parallelFor(long begin, long end, const Body& body, long grain = 0) {
+        if(begin >= end){
+            return;
+        }
+        if(grain <= 0){
+            grain = (end - begin) / (64 * (numWorkers() + 1));
+            grain = grain > 0 ? grain : 1;
+        }
+        Group group(*this);
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        spawn(new RangeTask<Body>(&group, body, begin, end, grain));
+        group.wait();
+    }
+
+    unsigned int numWorkers() const {
+        return workers.size();
+    }
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers;
+    //tasks spawned by threads outside the pool
+    std::deque<Task*> shared_tasks;
+    MutexLock shared_m;
+    std::atomic<long> shared_size;
+    //workers about to sleep or sleeping, a spawn bumps work_epoch only if there are some
+    std::atomic<unsigned int> idle_workers;
+    //the futex word the idle workers sleep on
+    std::atomic<unsigned int> work_epoch;
+    std::atomic<unsigned int> sleeping_workers;
+    std::atomic<bool> stopping;
+    //bumped whenever a group's last task finishes, the futex word threads outside the pool wait on
+    std::atomic<unsigned int> finished_groups;
+    std::atomic<unsigned int> sleeping_waiters;
+
+    static void* workerMain(void* arg);
+    void spawn(Task* task);
+    //true if the calling thread has no spawned tasks waiting to run
+    bool localQueueEmpty();
+    Task* findTask();
+    void execute(Task* task);
+};
+
+template <typename Body>
+struct TaskPool::RangeTask : TaskPool::Task {
+    const Body& body;
+    long begin;
+    long end;
+    const long grain;
+
+    RangeTask(Group* group, const Body& body, long begin, long end, long grain) : Task(group), body(body)
+            , begin(begin), end(end), grain(grain) {}
+
+    void run() override {
+        TaskPool& pool = group->pool;
+        while(end - begin > grain){
+            if(pool.localQueueEmpty()){
+                long middle = begin + (end - begin) / 2;
+                group->pending.fetch_add(1, std::memory_order_relaxed);
+                pool.spawn(new RangeTask(group, body, middle, end, grain));
+                end = middle;
+                continue;
+            }
+            for(long stop = begin + grain; begin < stop; ++begin){
+                body(begin);
+            }
+        }
+        for(; begin < end; ++begin){
+            body(begin);
+        }
+    }
+};
+
+#endif // TASK_POOL_H_
@@ -4,10 +4,22 @@
 #include <pthread.h>
 #include <iostream>
 #include <iomanip> // std::setw
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include "NodePool.h"
+#include "Locks.h"
+#include "StripedCounter.h"
 
 using namespace std;
 
-template <typename T>
+/**
+ * @tparam Allocator creates and destroys the nodes, see NodePool.h. By default nodes are recycled through
+ * a per-list pool so their locks are initialized only once
+ * @tparam Lock the lock of every node, see Locks.h. SpinLock takes a single byte, so small nodes fit
+ * several to a cache line
+ */
+template <typename T, template <typename> class Allocator = PooledNodeAllocator, typename Lock = MutexLock>
 class List 
 {
     public:
@@ -15,45 +27,39 @@ class List
         /**
          * Constructor
          */
-        List() :  head(nullptr), dummy(Node()){
-            counter = 0;
-
+        List() :  head(nullptr), dummy(){
             dummy.next = nullptr;
             pthread_mutex_init(&head_m, nullptr);
-            pthread_mutex_init(&counter_m, nullptr);
         }
 
         /**
          * Destructor
          */
         ~List() {
-            pthread_mutex_lock(&dummy.m);
+            dummy.m.lock();
             Node* node = dummy.next;
             while(node != nullptr){
-                pthread_mutex_lock(&node->m);
-                pthread_mutex_unlock(&node->m);
+                node->m.lock();
+                node->m.unlock();
                 Node* tmp = node;
                 node = node->next;
-                delete tmp;
+                node_allocator.destroy(tmp);
             }
-            pthread_mutex_destroy(&counter_m);
-
             pthread_mutex_destroy(&head_m);
 
-            pthread_mutex_unlock(&dummy.m);
+            dummy.m.unlock();
 
         }
 
         class Node {
          public:
-          T data;
+          //next comes first so a small T packs with the lock instead of being padded to a pointer
           Node *next;
-          pthread_mutex_t m{};
-          Node(){pthread_mutex_init(&m, nullptr);};
-          explicit Node(const T& data_in, Node* next_in = nullptr) : data(data_in), next(next_in), m(PTHREAD_MUTEX_INITIALIZER) {}
-          ~Node() {
-              pthread_mutex_destroy(&m);
-          }
+          T data;
+          Lock m;
+          Node() : next(nullptr), data() {}
+          explicit Node(const T& data_in, Node* next_in = nullptr) : next(next_in), data(data_in) {}
+          explicit Node(T&& data_in, Node* next_in = nullptr) : next(next_in), data(std::move(data_in)) {}
         };
 
         /**
@@ -63,67 +69,23 @@ class List
          * @return true if a new node was added and false otherwise
          */
         bool insert(const T& data) {
-            Node *pred, *curr;
-            pred = &dummy;
-            pthread_mutex_lock(&pred->m);
-            if(pred->next == nullptr || pred->next->data > data){
-                Node* node = new Node(data);
-                if(pred->next != nullptr){
-                    pthread_mutex_lock(&head_m);
-                    node->next = pred->next;
-                    head = node;
-                    pthread_mutex_unlock(&head_m);
-                }
-                pred->next = node;
-                update_counter(1);
-                pthread_mutex_lock(&head_m);
-                head = node;
-                pthread_mutex_unlock(&head_m);
-                __insert_test_hook();
-                pthread_mutex_unlock(&pred->m);
-                return true;
-            }
-            curr = pred->next;
-            pthread_mutex_lock(&curr->m);
-            while(curr->data <= data){
-                if(curr->data == data){
-                    pthread_mutex_unlock(&pred->m);
-                    pthread_mutex_unlock(&curr->m);
-                    return false;
-                }
-                if(curr->next == nullptr || curr->next->data > data){
-                    pthread_mutex_unlock(&pred->m);
-                    pred = curr;
-                    curr = curr->next;
-                    if (curr != nullptr){
-                        pthread_mutex_lock(&curr->m);
-                    }
-                    Node* node = new Node(data);
-                    pred->next = node;
-                    update_counter(1);
-                    node->next = curr;
-
-                    if (curr != nullptr){
-                        pthread_mutex_unlock(&curr->m);
-                    }
-                    pthread_mutex_unlock(&pred->m);
-                    __insert_test_hook();
-                    return true;
-                }
+            return insertNode(node_allocator.create(data, nullptr));
+        }
 
-                pthread_mutex_unlock(&pred->m);
-                pred = curr;
-                curr = curr->next;
-                if(pred->next == nullptr){
-                    pthread_mutex_unlock(&pred->m);
-                    return false;
-                }
-                pthread_mutex_lock(&curr->m);
-            }
+        /**
+         * Like insert(const T&), but moves @param data into the node instead of copying it
+         */
+        bool insert(T&& data) {
+            return insertNode(node_allocator.create(std::move(data), nullptr));
+        }
 
-            pthread_mutex_unlock(&curr->m);
-            pthread_mutex_unlock(&pred->m);
-            return false;
+        /**
+         * Like insert, but constructs the data from @param args. The data is built (and moved into a node) before
+         * any lock is taken
+         */
+        template <typename... Args>
+        bool emplace(Args&&... args) {
+            return insertNode(node_allocator.create(T(std::forward<Args>(args)...), nullptr));
         }
 
         /**
@@ -134,22 +96,22 @@ class List
         bool remove(const T& value) {
             Node *pred, *curr;
             pred = &dummy;
-            pthread_mutex_lock(&pred->m);
+            pred->m.lock();
             if(pred->next == nullptr){
-                pthread_mutex_unlock(&pred->m);
+                pred->m.unlock();
                 return false;
             }
             curr = pred->next;
-            pthread_mutex_lock(&curr->m);
+            curr->m.lock();
             if(curr->data == value){
                 pred->next = curr->next;
                 pthread_mutex_lock(&head_m);
                 head = curr->next;
                 pthread_mutex_unlock(&head_m);
-                pthread_mutex_unlock(&curr->m);
-                delete curr;
+                curr->m.unlock();
+                node_allocator.destroy(curr);
                 update_counter(-1);
-                pthread_mutex_unlock(&pred->m);
+                pred->m.unlock();
                 __remove_test_hook();
                 return true;
             }
@@ -157,28 +119,250 @@ class List
             while(curr->data <= value){
                 if(curr->data == value){
                     pred->next = curr->next;
-                    pthread_mutex_unlock(&curr->m);
-                    delete curr;
+                    curr->m.unlock();
+                    node_allocator.destroy(curr);
                     update_counter(-1);
-                    pthread_mutex_unlock(&pred->m);
+                    pred->m.unlock();
                     __remove_test_hook();
                     return true;
                 }
 
-                pthread_mutex_unlock(&pred->m);
+                pred->m.unlock();
                 pred = curr;
                 curr = curr->next;
                 if(curr == nullptr){
-                    pthread_mutex_unlock(&pred->m);
+                    pred->m.unlock();
                     return false;
                 }
-                pthread_mutex_lock(&curr->m);
+                curr->m.lock();
             }
 
-            pthread_mutex_unlock(&curr->m);
-            pthread_mutex_unlock(&pred->m);
+            curr->m.unlock();
+            pred->m.unlock();
+            return false;
+
+        }
+
+        /**
+         * Looks for a node that its data equals to @param value, locking hand over hand like insert/remove.
+         * For lookups which take no locks at all use LazyList (LazyList.h)
+         * @param value the data to lookup
+         * @return true if a matched node was found and false otherwise
+         */
+        bool contains(const T& value) {
+            Node *pred, *curr;
+            pred = &dummy;
+            pred->m.lock();
+            curr = pred->next;
+            while(curr != nullptr){
+                curr->m.lock();
+                pred->m.unlock();
+                if(curr->data == value || curr->data > value){
+                    bool found = curr->data == value;
+                    curr->m.unlock();
+                    return found;
+                }
+                pred = curr;
+                curr = curr->next;
+            }
+            pred->m.unlock();
             return false;
+        }
+
+        /**
+         * A forward iterator which locks hand over hand: it holds the lock of the node it points to, and moving
+         * forward locks the next node before releasing the current one. It sees every node which stays in the list
+         * while it passes, nodes inserted or removed ahead of it may or may not be seen.
+         * Writers behind the iterator or further ahead than the next node never wait for it, but a writer which needs
+         * its node waits until it moves on, so don't keep an iterator while using the list from the same thread
+         */
+        class Iterator {
+         public:
+          Iterator() : node(nullptr) {}
+          Iterator(Iterator&& other) noexcept : node(other.node) {
+              other.node = nullptr;
+          }
+          Iterator& operator=(Iterator&& other) noexcept {
+              if(this != &other){
+                  release();
+                  node = other.node;
+                  other.node = nullptr;
+              }
+              return *this;
+          }
+          Iterator(const Iterator&) = delete;
+          Iterator& operator=(const Iterator&) = delete;
+          ~Iterator() {
+              release();
+          }
+
+          const T& operator*() const {
+              return node->data;
+          }
+          const T* operator->() const {
+              return &node->data;
+          }
+          Iterator& operator++() {
+              Node* next = node->next;
+              if(next != nullptr){
+                  next->m.lock();
+              }
+              node->m.unlock();
+              node = next;
+              return *this;
+          }
+          bool operator==(const Iterator& other) const {
+              return node == other.node;
+          }
+          bool operator!=(const Iterator& other) const {
+              return node != other.node;
+          }
+
+          /**
+           * Unlocks the node and turns the iterator into end()
+           */
+          void release() {
+              if(node != nullptr){
+                  node->m.unlock();
+                  node = nullptr;
+              }
+          }
+
+         private:
+          friend class List;
+          explicit Iterator(Node* locked) : node(locked) {}
+          Node* node;
+        };
+
+        /**
+         * @return an iterator to the smallest data in the list
+         */
+        Iterator begin() {
+            Node* pred = &dummy;
+            pred->m.lock();
+            Node* curr = pred->next;
+            if(curr != nullptr){
+                curr->m.lock();
+            }
+            pred->m.unlock();
+            return Iterator(curr);
+        }
+
+        Iterator end() {
+            return Iterator();
+        }
+
+        /**
+         * @return an iterator to the smallest data which isn't smaller than @param value
+         */
+        Iterator lowerBound(const T& value) {
+            Node *pred, *curr;
+            pred = &dummy;
+            pred->m.lock();
+            curr = pred->next;
+            while(curr != nullptr){
+                curr->m.lock();
+                pred->m.unlock();
+                if(!(curr->data < value)){
+                    return Iterator(curr);
+                }
+                pred = curr;
+                curr = curr->next;
+            }
+            pred->m.unlock();
+            return Iterator();
+        }
+
+        /**
+         * Calls @param visitor with the data of every node in ascending order, locking hand over hand.
+         * The visitor runs while the node is locked, so it must not use the list
+         * @param visitor called as visitor(const T&)
+         */
+        template <typename Visitor>
+        void forEach(Visitor visitor) {
+            for(Iterator it = begin(); it != end(); ++it){
+                visitor(*it);
+            }
+        }
+
+        /**
+         * Calls @param visitor with the data of every node in [@param lo, @param hi) in ascending order,
+         * like forEach. Only the nodes up to the first one which isn't smaller than @param hi are locked,
+         * each for a moment
+         * @param visitor called as visitor(const T&)
+         */
+        template <typename Visitor>
+        void range(const T& lo, const T& hi, Visitor visitor) {
+            for(Iterator it = lowerBound(lo); it != end() && *it < hi; ++it){
+                visitor(*it);
+            }
+        }
+
+        /**
+         * Inserts all the values in [@param first, @param last) in a single pass over the list.
+         * The values are sorted first, so the list is walked (hand over hand) once for the whole batch
+         * instead of once per value. Values which are already in the list, or appear twice, are added once
+         * @return the number of nodes which were added
+         */
+        template <typename InputIt>
+        unsigned int insertBatch(InputIt first, InputIt last) {
+            vector<T> values = sortedBatch(first, last);
+            unsigned int added = 0;
+            Node* pred = &dummy;
+            pred->m.lock();
+            for(const T& value : values){
+                pred = lockPredOf(pred, value);
+                if(pred->next != nullptr && pred->next->data == value){
+                    continue;
+                }
+                Node* node = node_allocator.create(value, pred->next);
+                //nobody can reach the node before we link it, so locking it can't block
+                node->m.lock();
+                linkAfter(pred, node);
+                pred->m.unlock();
+                pred = node;
+                ++added;
+            }
+            pred->m.unlock();
+            if(added != 0){
+                update_counter(added);
+            }
+            for(unsigned int i = 0; i < added; ++i){
+                __insert_test_hook();
+            }
+            return added;
+        }
 
+        /**
+         * Removes all the values in [@param first, @param last) in a single pass over the list, see insertBatch
+         * @return the number of nodes which were removed
+         */
+        template <typename InputIt>
+        unsigned int removeBatch(InputIt first, InputIt last) {
+            vector<T> values = sortedBatch(first, last);
+            unsigned int removed = 0;
+            Node* pred = &dummy;
+            pred->m.lock();
+            for(const T& value : values){
+                pred = lockPredOf(pred, value);
+                Node* curr = pred->next;
+                if(curr == nullptr || !(curr->data == value)){
+                    continue;
+                }
+                curr->m.lock();
+                linkAfter(pred, curr->next);
+                curr->m.unlock();
+                node_allocator.destroy(curr);
+                ++removed;
+            }
+            pred->m.unlock();
+            if(removed != 0){
+                update_counter(-(int)removed);
+            }
+            for(unsigned int i = 0; i < removed; ++i){
+                __remove_test_hook();
+            }
+            return removed;
         }
 
         /**
@@ -186,11 +370,7 @@ class List
          * @return current size of the list
          */
         unsigned int getSize() {
-            unsigned int i;
-            pthread_mutex_lock(&counter_m);
-            i = counter;
-            pthread_mutex_unlock(&counter_m);
-            return i;
+            return counter.sum();
         }
 
 		// Don't remove
@@ -222,16 +402,70 @@ class List
         virtual void __remove_test_hook() {}
 
 private:
+    Allocator<Node> node_allocator;
     Node* head;
     Node dummy;
         pthread_mutex_t head_m{};
-        pthread_mutex_t counter_m{};
-        int counter;
+        //striped so threads which work on different parts of the list don't share its cache line
+        StripedCounter counter;
+
+        template <typename InputIt>
+        static vector<T> sortedBatch(InputIt first, InputIt last) {
+            vector<T> values(first, last);
+            sort(values.begin(), values.end());
+            values.erase(unique(values.begin(), values.end()), values.end());
+            return values;
+        }
+
+        /**
+         * Links @param node, which is already built, into its place. The node is destroyed if its data is already
+         * in the list
+         * @return true if the node was linked
+         */
+        bool insertNode(Node* node) {
+            Node* pred = &dummy;
+            pred->m.lock();
+            pred = lockPredOf(pred, node->data);
+            if(pred->next != nullptr && pred->next->data == node->data){
+                pred->m.unlock();
+                node_allocator.destroy(node);
+                return false;
+            }
+            node->next = pred->next;
+            linkAfter(pred, node);
+            update_counter(1);
+            pred->m.unlock();
+            __insert_test_hook();
+            return true;
+        }
+
+        /**
+         * Moves forward hand over hand from @param pred, which is locked, to the last node whose data is smaller
+         * than @param value (the node @param value would be inserted after)
+         * @return that node, locked, all the nodes before it are unlocked
+         */
+        Node* lockPredOf(Node* pred, const T& value) {
+            while(pred->next != nullptr && pred->next->data < value){
+                Node* curr = pred->next;
+                curr->m.lock();
+                pred->m.unlock();
+                pred = curr;
+            }
+            return pred;
+        }
+
+        //sets pred->next, keeping head up to date when pred is the dummy. pred must be locked
+        void linkAfter(Node* pred, Node* next) {
+            pred->next = next;
+            if(pred == &dummy){
+                pthread_mutex_lock(&head_m);
+                head = next;
+                pthread_mutex_unlock(&head_m);
+            }
+        }
 
         void update_counter(int update) {
-            pthread_mutex_lock(&counter_m);
-            counter += update;
-            pthread_mutex_unlock(&counter_m);
+            counter.add(update);
         }
 
 
@@ -0,0 +1,30 @@
+#include "Futex.h"
+#include "TreeBarrier.h"
+
+TreeBarrier::TreeBarrier(unsigned int num_of_threads, unsigned int fan_out) : num_of_threads(num_of_threads)
+        , fan_out(fan_out < 2 ? 2 : fan_out), slots(num_of_threads), tickets(0), spin_limit(defaultSpinLimit()) {
+    for(unsigned int i = 1; i < num_of_threads; ++i){
+        ++slots[(i - 1) / this->fan_out].children;
+    }
+}
+
+void TreeBarrier::wait() {
+    //a thread leaves a phase only after all of it took their tickets, so every phase gets all the ids once
+    wait(tickets.fetch_add(1, std::memory_order_relaxed) % num_of_threads);
+}
+
+void TreeBarrier::wait(unsigned int id) {
+    Slot& slot = slots[id];
+    unsigned int phase = ++slot.phase;
+    //the counters never reset, children can't arrive at the next phase before we release them
+    waitUntil(slot.arrived, slot.children * phase, slot.arrived_sleepers, spin_limit);
+    if(id != 0){
+        Slot& parent = slots[(id - 1) / fan_out];
+        addAndWake(parent.arrived, 1, parent.arrived_sleepers);
+        waitUntil(slot.released, phase, slot.released_sleepers, spin_limit);
+    }
+    unsigned int first_child = id * fan_out + 1;
+    for(unsigned int child = first_child; child < first_child + slot.children; ++child){
+        storeAndWake(slots[child].released, phase, slots[child].released_sleepers);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TREE_BARRIER_H_
+#define TREE_BARRIER_H_
+
+#include <atomic>
+#include <vector>
+
+/**
+ * A drop-in replacement of Barrier (Barrier.h) for many threads.
+ * The threads are the nodes of a tree with a configurable fan-out, thread i is the parent of threads
+ * fan_out * i + 1 ... fan_out * i + fan_out. A thread waits for its children to arrive, reports to its parent,
+ * waits for its parent's release and releases its children, so a phase takes O(log n) steps and every thread
+ * spins only on the flags of its own cache line. A fan-out of the number of cores which share a cache or a
+ * NUMA node keeps every group of siblings local.
+ * wait(id) is the cheaper call, every thread passes a different id in [0, num_of_threads) and keeps it
+ * for all the phases. wait() hands out the ids by order of arrival, which costs one shared atomic increment.
+ */
+class TreeBarrier {
+    struct alignas(64) Slot {
+        //arrivals of the children, grows by the number of children every phase
+        std::atomic<unsigned int> arrived;
+        //the last phase the parent released
+        std::atomic<unsigned int> released;
+        //threads which may sleep on arrived / released
+        std::atomic<unsigned int> arrived_sleepers;
+        std::atomic<unsigned int> released_sleepers;
+        //phases the owner of the slot passed, touched only by it
+        unsigned int phase;
+        unsigned int children;
+        Slot() : arrived(0), released(0), arrived_sleepers(0), released_sleepers(0), phase(0), children(0) {}
+    };
+    const unsigned int num_of_threads;
+    const unsigned int fan_out;
+    std::vector<Slot> slots;
+    //hands out the ids of wait(), ticket % num_of_threads
+    std::atomic<unsigned long> tickets;
+    const unsigned int spin_limit;
+public:
+    /**
+     * @param num_of_threads number of threads which wait on the barrier every phase
+     * @param fan_out number of children of every node, at least 2
+     */
+    explicit TreeBarrier(unsigned int num_of_threads, unsigned int fan_out = 4);
+    void wait();
+    /**
+     * @param id the id of the calling thread, in [0, num_of_threads)
+     */
+    void wait(unsigned int id);
+    ~TreeBarrier() = default;
+
+};
+
+#endif // TREE_BARRIER_H_
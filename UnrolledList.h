@@ -0,0 +1,236 @@
+#ifndef UNROLLED_LIST_H_
+#define UNROLLED_LIST_H_
+
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <iostream>
+#include <iomanip> // std::setw
+#include "Locks.h"
+
+/**
+ * A sorted set with the interface of List (ThreadSafeList.h) whose nodes hold a sorted array of keys each,
+ * sized to fill two cache lines, under a single lock. A traversal takes one lock and (about) one cache miss
+ * per node instead of per key.
+ * Nodes are locked hand over hand like in List. The first node (the dummy) holds the smallest keys. A full node
+ * is split in two, a node which drops under a quarter full takes the keys of the node after it if they fit, and
+ * a node which is left empty is unlinked by the next traversal which passes it.
+ * T must be default constructible, copy assignable and support operator< and operator==.
+ * @tparam Lock the lock of every node, see Locks.h
+ */
+template <typename T, typename Lock = MutexLock>
+class UnrolledList
+{
+    public:
+        static const unsigned int NODE_BYTES = 128;
+        static const unsigned int CAPACITY =
+                (NODE_BYTES - sizeof(void*) - sizeof(Lock) - sizeof(unsigned int)) / sizeof(T) > 4
+                ? (NODE_BYTES - sizeof(void*) - sizeof(Lock) - sizeof(unsigned int)) / sizeof(T) : 4;
+
+        class alignas(64) Node {
+         public:
+          Node *next;
+          Lock m;
+          unsigned int count;
+          T keys[CAPACITY];
+          Node() : next(nullptr), count(0) {}
+
+          /**
+           * Branch-free for arithmetic T, it counts instead of searching so the compiler can vectorize it
+           * @return the number of keys which are smaller than @param key
+           */
+          unsigned int rank(const T& key) const {
+              if(std::is_arithmetic<T>::value){
+                  unsigned int smaller = 0;
+                  for(unsigned int i = 0; i < count; ++i){
+                      smaller += keys[i] < key;
+                  }
+                  return smaller;
+              }
+              return std::lower_bound(keys, keys + count, key) - keys;
+          }
+        };
+
+        /**
+         * Constructor
+         */
+        UnrolledList() : counter(0) {}
+
+        /**
+         * Destructor, no other thread may use the list anymore
+         */
+        ~UnrolledList() {
+            Node* node = dummy.next;
+            while(node != nullptr){
+                Node* tmp = node;
+                node = node->next;
+                delete tmp;
+            }
+        }
+
+        /**
+         * Insert new node to list while keeping the list ordered in an ascending order
+         * If there is already a node has the same data as @param data then return false (without adding it again)
+         * @param data the new data to be added to the list
+         * @return true if a new node was added and false otherwise
+         */
+        bool insert(const T& data) {
+            //the node a split needs, allocated with no lock held: the first time we find our node full we let go
+            //of it, allocate and walk again
+            Node* spare = nullptr;
+            while(true){
+                Node* node = lockNodeOf(data);
+                unsigned int pos = node->rank(data);
+                if(pos < node->count && node->keys[pos] == data){
+                    node->m.unlock();
+                    delete spare;
+                    return false;
+                }
+                if(node->count == CAPACITY){
+                    if(spare == nullptr){
+                        node->m.unlock();
+                        spare = new Node();
+                        continue;
+                    }
+                    //move the upper half to the new node, nobody can reach it before we link it so it needs no lock
+                    Node* upper = spare;
+                    spare = nullptr;
+                    unsigned int half = CAPACITY / 2;
+                    std::copy(node->keys + half, node->keys + CAPACITY, upper->keys);
+                    upper->count = CAPACITY - half;
+                    node->count = half;
+                    upper->next = node->next;
+                    node->next = upper;
+                    if(pos > half){
+                        insertAt(upper, pos - half, data);
+                    } else {
+                        insertAt(node, pos, data);
+                    }
+                } else {
+                    insertAt(node, pos, data);
+                }
+                node->m.unlock();
+                //somebody else may have made room in the node while we were allocating
+                delete spare;
+                counter.fetch_add(1, std::memory_order_relaxed);
+                __insert_test_hook();
+                return true;
+            }
+        }
+
+        /**
+         * Remove the node that its data equals to @param value
+         * @param value the data to lookup a node that has the same data to be removed
+         * @return true if a matched node was found and removed and false otherwise
+         */
+        bool remove(const T& value) {
+            Node* node = lockNodeOf(value);
+            unsigned int pos = node->rank(value);
+            if(pos == node->count || !(node->keys[pos] == value)){
+                node->m.unlock();
+                return false;
+            }
+            std::copy(node->keys + pos + 1, node->keys + node->count, node->keys + pos);
+            --node->count;
+            Node* next = node->next;
+            if(node->count < CAPACITY / 4 && next != nullptr){
+                next->m.lock();
+                if(node->count + next->count <= CAPACITY / 2){
+                    std::copy(next->keys, next->keys + next->count, node->keys + node->count);
+                    node->count += next->count;
+                    unlinkNext(node);
+                } else {
+                    next->m.unlock();
+                }
+            }
+            node->m.unlock();
+            counter.fetch_sub(1, std::memory_order_relaxed);
+            __remove_test_hook();
+            return true;
+        }
+
+        /**
+         * @param value the data to lookup
+         * @return true if a node with the same data is in the list
+         */
+        bool contains(const T& value) {
+            Node* node = lockNodeOf(value);
+            unsigned int pos = node->rank(value);
+            bool found = pos < node->count && node->keys[pos] == value;
+            node->m.unlock();
+            return found;
+        }
+
+        /**
+         * Returns the current size of the list
+         * @return current size of the list
+         */
+        unsigned int getSize() {
+            return counter.load(std::memory_order_relaxed);
+        }
+
+		// Don't remove
+        void print() {
+          for (Node* temp = &dummy; temp != nullptr; temp = temp->next)
+          {
+            for (unsigned int i = 0; i < temp->count; ++i)
+            {
+              std::cout << std::right << std::setw(3) << temp->keys[i] << " ";
+            }
+          }
+          std::cout << std::endl;
+        }
+
+		// Don't remove
+        virtual void __insert_test_hook() {}
+		// Don't remove
+        virtual void __remove_test_hook() {}
+
+private:
+    Node dummy;
+    std::atomic<int> counter;
+
+    /**
+     * Walks hand over hand to the node @param key belongs to, the last one whose first key isn't bigger than it
+     * (or the dummy), unlinking the empty nodes on the way
+     * @return that node, locked
+     */
+    Node* lockNodeOf(const T& key) {
+        Node* node = &dummy;
+        node->m.lock();
+        while(node->next != nullptr){
+            Node* next = node->next;
+            next->m.lock();
+            if(next->count == 0){
+                unlinkNext(node);
+                continue;
+            }
+            if(key < next->keys[0]){
+                next->m.unlock();
+                break;
+            }
+            node->m.unlock();
+            node = next;
+        }
+        return node;
+    }
+
+    /**
+     * Unlinks and deletes node->next, both must be locked. Anyone else who would lock node->next has to
+     * lock node first, so nobody can be waiting for it
+     */
+    static void unlinkNext(Node* node) {
+        Node* next = node->next;
+        node->next = next->next;
+        next->m.unlock();
+        delete next;
+    }
+
+    static void insertAt(Node* node, unsigned int pos, const T& data) {
+        std::copy_backward(node->keys + pos, node->keys + node->count, node->keys + node->count + 1);
+        node->keys[pos] = data;
+        ++node->count;
+    }
+};
+
+#endif //UNROLLED_LIST_H_
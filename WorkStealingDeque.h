@@ -0,0 +1,138 @@
+#ifndef WORK_STEALING_DEQUE_H_
+#define WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <vector>
+
+/**
+ * Chase-Lev work-stealing deque of pointers (Chase & Lev 2005, with the C11 orderings of Le et al. 2013).
+ * The owner thread pushes and pops at the bottom, LIFO, without atomic read-modify-writes except when a single
+ * item is left. Any other thread steals from the top, FIFO, with one compare-and-swap.
+ * The ring grows when full, the old rings are kept until the deque is destroyed because a thief may still read
+ * from one.
+ */
+template <typename T>
+class WorkStealingDeque {
+    struct Ring {
+        const long capacity;
+        std::atomic<T*>* slots;
+
+        explicit Ring(long capacity) : capacity(capacity), slots(new std::atomic<T*>[capacity]) {}
+        ~Ring() {
+            delete[] slots;
+        }
+        //capacity is a power of 2
+        std::atomic<T*>& at(long index) {
+            return slots[index & (capacity - 1)];
+        }
+    };
+
+    //thieves and the owner on separate cache lines
+    alignas(64) std::atomic<long> top;
+    alignas(64) std::atomic<long> bottom;
+    std::atomic<Ring*> ring;
+    //rings replaced by grow, touched only by the owner
+    std::vector<Ring*> retired;
+
+    Ring* grow(Ring* old, long b, long t) {
+        Ring* bigger = new Ring(old->capacity * 2);
+        for(long i = t; i < b; ++i){
+            bigger->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        retired.push_back(old);
+        ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+public:
+    /**
+     * @param capacity initial number of slots, rounded up to a power of 2
+     */
+    explicit WorkStealingDeque(long capacity = 256) : top(0), bottom(0) {
+        long rounded = 1;
+        while(rounded < capacity){
+            rounded *= 2;
+        }
+        ring.store(new Ring(rounded), std::memory_order_relaxed);
+    }
+    ~WorkStealingDeque() {
+        delete ring.load(std::memory_order_relaxed);
+        for(Ring* old : retired){
+            delete old;
+        }
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * owner only.
+     * @param item pushed at the bottom
+     */
+    void push(T* item) {
+        long b = bottom.load(std::memory_order_relaxed);
+        long t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if(b - t >= r->capacity){
+            r = grow(r, b, t);
+        }
+        r->at(b).store(item, std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * owner only.
+     * @return the item at the bottom, nullptr if the deque is empty
+     */
+    T* pop() {
+        long b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        //seq_cst store and load: either the thieves see the lowered bottom or we see their top
+        bottom.store(b, std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_seq_cst);
+        if(t > b){
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = r->at(b).load(std::memory_order_relaxed);
+        if(t == b){
+            //the last item, race the thieves for it
+            if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /**
+     * any thread.
+     * @return the item at the top, nullptr if the deque is empty or another thread took it first
+     */
+    T* steal() {
+        long t = top.load(std::memory_order_seq_cst);
+        long b = bottom.load(std::memory_order_seq_cst);
+        if(t >= b){
+            return nullptr;
+        }
+        Ring* r = ring.load(std::memory_order_acquire);
+        T* item = r->at(t).load(std::memory_order_acquire);
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+            return nullptr;
+        }
+        return item;
+    }
+
+    /**
+     * @return number of items, exact only when called by the owner with no thieves around
+     */
+    long size() const {
+        long b = bottom.load(std::memory_order_relaxed);
+        long t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
+
+#endif // WORK_STEALING_DEQUE_H_
@@ -0,0 +1,187 @@
+/*
+ * stress test of the barriers: many threads run many phases, every phase checks that nobody left it before
+ * everyone arrived, and that the SplitBarrier's completion ran exactly once per phase.
+ * build: g++ -std=c++17 -O2 -pthread barrier_test.cpp Barrier.cpp SenseBarrier.cpp TreeBarrier.cpp
+ *        DisseminationBarrier.cpp SplitBarrier.cpp -o barrier_test
+ * usage: barrier_test [--threads=8] [--phases=20000]
+ * prints the failed checks and exits with 1 if there were any.
+ */
+#include <pthread.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Barrier.h"
+#include "SenseBarrier.h"
+#include "TreeBarrier.h"
+#include "DisseminationBarrier.h"
+#include "SplitBarrier.h"
+
+static std::atomic<unsigned long> failures(0);
+
+static void fail(const char* test, const char* what, unsigned long phase){
+    if(failures.fetch_add(1) < 10){
+        fprintf(stderr, "%s: %s at phase %lu\n", test, what, phase);
+    }
+}
+
+/*
+ * every thread bumps the phase's arrivals, waits and checks that all of them arrived.
+ */
+template <typename B>
+struct WaitTest{
+    B* barrier;
+    unsigned int num_threads;
+    unsigned long phases;
+    std::atomic<unsigned long> arrivals{0};
+    const char* name;
+};
+
+template <typename B>
+static void* waitWorker(void* ptr){
+    auto* test = static_cast<WaitTest<B>*>(ptr);
+    for(unsigned long phase = 0; phase < test->phases; ++phase){
+        test->arrivals.fetch_add(1);
+        test->barrier->wait();
+        if(test->arrivals.load() < (phase + 1) * test->num_threads){
+            fail(test->name, "left before everyone arrived", phase);
+        }
+        //a second wait, so nobody arrives at the next phase before everyone checked this one
+        test->barrier->wait();
+    }
+    return nullptr;
+}
+
+template <typename B>
+static void runWaitTest(const char* name, unsigned int num_threads, unsigned long phases){
+    B barrier(num_threads);
+    WaitTest<B> test;
+    test.barrier = &barrier;
+    test.num_threads = num_threads;
+    test.phases = phases;
+    test.name = name;
+    std::vector<pthread_t> tids(num_threads);
+    for(auto& tid : tids){
+        pthread_create(&tid, nullptr, waitWorker<B>, &test);
+    }
+    for(auto& tid : tids){
+        pthread_join(tid, nullptr);
+    }
+    printf("%-22s %lu phases\n", name, phases);
+}
+
+/*
+ * the threads split their phases with random local work, and drop out one after the other at random phases.
+ * the completion checks that it runs once per phase, after exactly the expected arrivals.
+ */
+struct SplitTest{
+    SplitBarrier* barrier;
+    unsigned long phases;
+    //phases completed, bumped only by the completion
+    unsigned long completions = 0;
+    std::atomic<unsigned long> arrivals{0};
+    //threads taking part in the current phase, as the completion expects them
+    unsigned long members = 0;
+    unsigned long pending_drops = 0;
+    std::atomic<unsigned long> drops{0};
+};
+
+struct SplitArgs{
+    SplitTest* test;
+    unsigned long drop_phase;
+    unsigned int seed;
+};
+
+static void* splitWorker(void* ptr){
+    auto* args = static_cast<SplitArgs*>(ptr);
+    SplitTest* test = args->test;
+    std::mt19937 rng(args->seed);
+    for(unsigned long phase = 0; phase < test->phases; ++phase){
+        test->arrivals.fetch_add(1);
+        if(phase == args->drop_phase){
+            test->drops.fetch_add(1);
+            test->barrier->arriveAndDrop();
+            return nullptr;
+        }
+        SplitBarrier::Token token = test->barrier->arrive();
+        volatile unsigned int work = 0;
+        for(unsigned int i = rng() % 256; i > 0; --i){
+            work = work + i;
+        }
+        test->barrier->wait(token);
+        if(test->completions != phase + 1){
+            fail("split", "completion count doesn't match the phase", phase);
+        }
+    }
+    return nullptr;
+}
+
+static void runSplitTest(unsigned int num_threads, unsigned long phases){
+    SplitTest test;
+    test.phases = phases;
+    test.members = num_threads;
+    //every phase's arrivals are counted by the completion, drops leave the group from the next phase on
+    unsigned long counted = 0;
+    SplitBarrier barrier(num_threads, [&test, &counted]{
+        unsigned long arrivals = test.arrivals.load();
+        if(arrivals - counted != test.members){
+            fail("split", "completion ran with the wrong number of arrivals", test.completions);
+        }
+        counted = arrivals;
+        unsigned long drops = test.drops.load();
+        test.members -= drops - test.pending_drops;
+        test.pending_drops = drops;
+        ++test.completions;
+    });
+    test.barrier = &barrier;
+    std::vector<SplitArgs> args(num_threads);
+    std::vector<pthread_t> tids(num_threads);
+    std::mt19937 rng(1);
+    for(unsigned int i = 0; i < num_threads; ++i){
+        args[i].test = &test;
+        //one thread stays to the end
+        args[i].drop_phase = i == 0 ? phases : rng() % phases;
+        args[i].seed = i + 1;
+        pthread_create(&tids[i], nullptr, splitWorker, &args[i]);
+    }
+    for(auto& tid : tids){
+        pthread_join(tid, nullptr);
+    }
+    if(test.completions != phases){
+        fail("split", "wrong number of completions", test.completions);
+    }
+    printf("%-22s %lu phases, %lu completions\n", "split/arriveAndDrop", phases, test.completions);
+}
+
+int main(int argc, char** argv){
+    unsigned int num_threads = 8;
+    unsigned long phases = 20000;
+    for(int i = 1; i < argc; ++i){
+        if(strncmp(argv[i], "--threads=", 10) == 0){
+            num_threads = atoi(argv[i] + 10);
+        } else if(strncmp(argv[i], "--phases=", 9) == 0){
+            phases = strtoul(argv[i] + 9, nullptr, 10);
+        } else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if(num_threads == 0 || phases == 0){
+        fprintf(stderr, "threads and phases must be positive\n");
+        return 1;
+    }
+    runWaitTest<Barrier>("Barrier", num_threads, phases);
+    runWaitTest<SenseBarrier>("SenseBarrier", num_threads, phases);
+    runWaitTest<TreeBarrier>("TreeBarrier", num_threads, phases);
+    runWaitTest<DisseminationBarrier>("DisseminationBarrier", num_threads, phases);
+    runWaitTest<SplitBarrier>("SplitBarrier", num_threads, phases);
+    runSplitTest(num_threads, phases);
+    if(failures.load() != 0){
+        printf("%lu checks failed\n", failures.load());
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
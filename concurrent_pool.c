@@ -0,0 +1,252 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "memory_pool.h"
+#include "concurrent_pool.h"
+
+//number of blocks in a full magazine
+#define MAGAZINE_SIZE 32
+#define CACHE_LINE_SIZE 64
+
+/*
+ * the depot's head is a pointer with a tag in its unused high bits (user space addresses fit in 48 bits),
+ * the tag changes on every push so a pop can't succeed on a head which was popped and pushed back
+ * in the meantime (the ABA problem).
+ */
+#define TAG_SHIFT 48
+#define POINTER_MASK ((UINT64_C(1) << TAG_SHIFT) - 1)
+
+/*
+ * a magazine is a list of free blocks linked through their first word.
+ * while a magazine sits in the depot its first block also holds the next magazine and the size.
+ */
+struct magazine{
+    void* blocks;
+    size_t count;
+};
+
+struct magazine_header{
+    void* next_block;
+    struct magazine_header* next_magazine;
+    size_t count;
+};
+
+/*
+ * the magazines of a single thread, a full one and one which we allocate from and free to.
+ * keeping two lets a thread which alternates between allocating and freeing around a full/empty
+ * magazine do so without going to the depot every time.
+ */
+struct thread_cache{
+    struct magazine loaded;
+    struct magazine previous;
+    concurrent_pool* pool;
+    //all the caches of a pool, so they can be freed when it's destroyed
+    struct thread_cache* next;
+    struct thread_cache* prev;
+};
+
+struct concurrent_pool{
+    //written by every exchange of magazines, so it gets a cache line of its own
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t depot;
+    _Alignas(CACHE_LINE_SIZE) pthread_key_t key;
+    //protects everything below
+    pthread_mutex_t lock;
+    memory_pool* blocks;
+    struct thread_cache* caches;
+};
+
+static uint64_t depot_pack(struct magazine_header* head, uint64_t tag){
+    return (uint64_t)(uintptr_t)head | (tag << TAG_SHIFT);
+}
+
+static struct magazine_header* depot_head(uint64_t depot){
+    return (struct magazine_header*)(uintptr_t)(depot & POINTER_MASK);
+}
+
+static void depot_push(concurrent_pool* pool, struct magazine* mag){
+    struct magazine_header* header = (struct magazine_header*)mag->blocks;
+    header->count = mag->count;
+    uint64_t old = atomic_load_explicit(&pool->depot, memory_order_relaxed);
+    do {
+        header->next_magazine = depot_head(old);
+    } while(!atomic_compare_exchange_weak_explicit(&pool->depot, &old, depot_pack(header, (old >> TAG_SHIFT) + 1),
+            memory_order_release, memory_order_relaxed));
+    mag->blocks = NULL;
+    mag->count = 0;
+}
+
+/*
+ * moves a magazine from the depot into mag, which must be empty.
+ * returns 0 in-case the depot is empty
+ */
+static int depot_pop(concurrent_pool* pool, struct magazine* mag){
+    uint64_t old = atomic_load_explicit(&pool->depot, memory_order_acquire);
+    struct magazine_header* header;
+    do {
+        header = depot_head(old);
+        if(header == NULL){
+            return 0;
+        }
+        //the magazine may be popped and its blocks reused by now, which is harmless as the memory
+        //of a pool is never freed before it's destroyed, and the tag makes the exchange fail then.
+    } while(!atomic_compare_exchange_weak_explicit(&pool->depot, &old,
+            depot_pack(__atomic_load_n(&header->next_magazine, __ATOMIC_RELAXED), old >> TAG_SHIFT),
+            memory_order_acquire, memory_order_acquire));
+    mag->blocks = header;
+    mag->count = header->count;
+    return 1;
+}
+
+/*
+ * fills mag, which must be empty, with new blocks.
+ * returns 0 in-case the pool has no more blocks
+ */
+static int carve_magazine(concurrent_pool* pool, struct magazine* mag){
+    pthread_mutex_lock(&pool->lock);
+    while(mag->count < MAGAZINE_SIZE){
+        void* block = memory_pool_alloc(pool->blocks);
+        if(block == NULL){
+            break;
+        }
+        *(void**)block = mag->blocks;
+        mag->blocks = block;
+        ++mag->count;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return mag->count != 0;
+}
+
+/*
+ * called when a thread exits, its blocks go back to the depot.
+ */
+static void thread_cache_destroy(void* ptr){
+    struct thread_cache* cache = (struct thread_cache*)ptr;
+    concurrent_pool* pool = cache->pool;
+    if(cache->loaded.count != 0){
+        depot_push(pool, &cache->loaded);
+    }
+    if(cache->previous.count != 0){
+        depot_push(pool, &cache->previous);
+    }
+    pthread_mutex_lock(&pool->lock);
+    if(cache->prev != NULL){
+        cache->prev->next = cache->next;
+    } else {
+        pool->caches = cache->next;
+    }
+    if(cache->next != NULL){
+        cache->next->prev = cache->prev;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    free(cache);
+}
+
+static struct thread_cache* thread_cache_get(concurrent_pool* pool){
+    struct thread_cache* cache = (struct thread_cache*)pthread_getspecific(pool->key);
+    if(cache != NULL){
+        return cache;
+    }
+    cache = (struct thread_cache*)calloc(1, sizeof(struct thread_cache));
+    if(cache == NULL){
+        return NULL;
+    }
+    cache->pool = pool;
+    pthread_mutex_lock(&pool->lock);
+    cache->next = pool->caches;
+    if(pool->caches != NULL){
+        pool->caches->prev = cache;
+    }
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_setspecific(pool->key, cache);
+    return cache;
+}
+
+concurrent_pool* concurrent_pool_create(size_t block_size, size_t initial_blocks, size_t grow_blocks){
+    //a magazine in the depot keeps its header in its first block
+    if(block_size < sizeof(struct magazine_header)){
+        block_size = sizeof(struct magazine_header);
+    }
+    concurrent_pool* pool = (concurrent_pool*) aligned_alloc(CACHE_LINE_SIZE, sizeof(concurrent_pool));
+    if(pool == NULL){
+        return NULL;
+    }
+    pool->blocks = memory_pool_create(block_size, initial_blocks, grow_blocks);
+    if(pool->blocks == NULL){
+        free(pool);
+        return NULL;
+    }
+    if(pthread_key_create(&pool->key, thread_cache_destroy) != 0){
+        memory_pool_destroy(pool->blocks);
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->depot, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->caches = NULL;
+    return pool;
+}
+
+void concurrent_pool_destroy(concurrent_pool* pool){
+    if(pool == NULL){
+        return;
+    }
+    pthread_key_delete(pool->key);
+    struct thread_cache* cache = pool->caches;
+    while(cache != NULL){
+        struct thread_cache* next = cache->next;
+        free(cache);
+        cache = next;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    memory_pool_destroy(pool->blocks);
+    free(pool);
+}
+
+void* concurrent_pool_alloc(concurrent_pool* pool){
+    struct thread_cache* cache = thread_cache_get(pool);
+    if(cache == NULL){
+        return NULL;
+    }
+    struct magazine* loaded = &cache->loaded;
+    if(loaded->count == 0){
+        if(cache->previous.count != 0){
+            struct magazine tmp = cache->loaded;
+            cache->loaded = cache->previous;
+            cache->previous = tmp;
+        } else if(!depot_pop(pool, loaded) && !carve_magazine(pool, loaded)){
+            return NULL;
+        }
+    }
+    void* ret_val = loaded->blocks;
+    loaded->blocks = *(void**)ret_val;
+    --loaded->count;
+    return ret_val;
+}
+
+void concurrent_pool_free(concurrent_pool* pool, void* ptr){
+    if(ptr == NULL){
+        return;
+    }
+    struct thread_cache* cache = thread_cache_get(pool);
+    if(cache == NULL){
+        //we can't cache it, so it goes to the depot as a magazine of its own
+        struct magazine mag = { ptr, 1 };
+        *(void**)ptr = NULL;
+        depot_push(pool, &mag);
+        return;
+    }
+    struct magazine* loaded = &cache->loaded;
+    if(loaded->count == MAGAZINE_SIZE){
+        if(cache->previous.count != 0){
+            depot_push(pool, &cache->previous);
+        }
+        cache->previous = cache->loaded;
+        loaded->blocks = NULL;
+        loaded->count = 0;
+    }
+    *(void**)ptr = loaded->blocks;
+    loaded->blocks = ptr;
+    ++loaded->count;
+}
@@ -0,0 +1,50 @@
+#ifndef CONCURRENT_POOL_H
+#define CONCURRENT_POOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * a pool of fixed size blocks which any number of threads may share without locking.
+ * every thread keeps its own magazines (small stacks of free blocks) of each pool it uses, and
+ * exchanges whole magazines with a lock-free stack (the depot) shared by all of them, so most
+ * allocations and frees touch only the calling thread's memory.
+ * a block may be freed by a different thread than the one which allocated it.
+ * new blocks are carved from a memory_pool which grows in chunks, under a lock which is taken
+ * only once per magazine.
+ */
+typedef struct concurrent_pool concurrent_pool;
+
+/*
+ * creates a pool of blocks of at least block_size bytes, aligned like anything malloc returns.
+ * initial_blocks blocks are allocated right away, and whenever the pool runs out of blocks it grows
+ * by a chunk of grow_blocks blocks. grow_blocks == 0 makes a fixed pool which never grows,
+ * note that blocks which sit in other threads' magazines can't be allocated by this one.
+ * returns NULL in-case of failure
+ */
+concurrent_pool* concurrent_pool_create(size_t block_size, size_t initial_blocks, size_t grow_blocks);
+
+/*
+ * frees all the pool's memory, no thread may use the pool during or after the call.
+ */
+void concurrent_pool_destroy(concurrent_pool* pool);
+
+/*
+ * returns a free block of the pool
+ * returns NULL in-case no free blocks left and the pool can't grow
+ */
+void* concurrent_pool_alloc(concurrent_pool* pool);
+
+/*
+ * returns a block which has been allocated from the pool, by any thread, back to it. ptr may be NULL.
+ */
+void concurrent_pool_free(concurrent_pool* pool, void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CONCURRENT_POOL_H
@@ -0,0 +1,202 @@
+/*
+ * contention benchmark of the ListPolicies.h locking strategies.
+ * build: g++ -std=c++17 -O2 -pthread list_benchmark.cpp Barrier.cpp -o list_benchmark
+ * usage: list_benchmark [--policy=all|hand-over-hand|coarse-rwlock|optimistic|lock-free] [--threads=1,2,4,8]
+ *                       [--keys=1024] [--mix=90,5,5] [--seconds=1]
+ * every thread runs random operations on keys in [0, keys) for the given time, mix is the percentage of
+ * lookups, inserts and removes. the set starts half full. prints the throughput and latency percentiles
+ * of every policy and thread count.
+ */
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "Barrier.h"
+#include "ListPolicies.h"
+
+//latencies kept per thread, beyond that the operations are still counted but not timed
+#define MAX_SAMPLES (1 << 22)
+
+struct Config{
+    std::string policy = "all";
+    std::vector<unsigned int> threads = {1, 2, 4, 8};
+    int keys = 1024;
+    unsigned int lookup_percent = 90;
+    unsigned int insert_percent = 5;
+    double seconds = 1;
+};
+
+struct WorkerResult{
+    unsigned long ops = 0;
+    std::vector<uint32_t> latencies;
+};
+
+template <typename Set>
+struct WorkerArgs{
+    Set* set;
+    const Config* config;
+    Barrier* start;
+    std::atomic<bool>* stop;
+    unsigned int seed;
+    WorkerResult result;
+};
+
+template <typename Set>
+static void* worker(void* ptr){
+    auto* args = static_cast<WorkerArgs<Set>*>(ptr);
+    std::mt19937 rng(args->seed);
+    std::uniform_int_distribution<int> key_dist(0, args->config->keys - 1);
+    std::uniform_int_distribution<unsigned int> op_dist(0, 99);
+    args->result.latencies.reserve(MAX_SAMPLES);
+    args->start->wait();
+    while(!args->stop->load(std::memory_order_relaxed)){
+        int key = key_dist(rng);
+        unsigned int op = op_dist(rng);
+        auto before = std::chrono::steady_clock::now();
+        if(op < args->config->lookup_percent){
+            args->set->contains(key);
+        } else if(op < args->config->lookup_percent + args->config->insert_percent){
+            args->set->insert(key);
+        } else {
+            args->set->remove(key);
+        }
+        auto after = std::chrono::steady_clock::now();
+        if(args->result.latencies.size() < MAX_SAMPLES){
+            args->result.latencies.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+        }
+        ++args->result.ops;
+    }
+    return nullptr;
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(p / 100 * sorted.size()))];
+}
+
+template <typename Policy>
+static void run(const Config& config){
+    typedef ConcurrentList<int, Policy> Set;
+    for(unsigned int num_threads : config.threads){
+        Set set;
+        for(int key = 0; key < config.keys; key += 2){
+            set.insert(key);
+        }
+        Barrier start(num_threads + 1);
+        std::atomic<bool> stop(false);
+        std::vector<WorkerArgs<Set>> args(num_threads);
+        std::vector<pthread_t> tids(num_threads);
+        for(unsigned int i = 0; i < num_threads; ++i){
+            args[i].set = &set;
+            args[i].config = &config;
+            args[i].start = &start;
+            args[i].stop = &stop;
+            args[i].seed = i + 1;
+            pthread_create(&tids[i], nullptr, worker<Set>, &args[i]);
+        }
+        start.wait();
+        auto begin = std::chrono::steady_clock::now();
+        while(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() < config.seconds){
+            struct timespec nap = {0, 1000000};
+            nanosleep(&nap, nullptr);
+        }
+        stop.store(true);
+        unsigned long ops = 0;
+        std::vector<uint32_t> latencies;
+        for(unsigned int i = 0; i < num_threads; ++i){
+            pthread_join(tids[i], nullptr);
+            ops += args[i].result.ops;
+            latencies.insert(latencies.end(), args[i].result.latencies.begin(), args[i].result.latencies.end());
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::sort(latencies.begin(), latencies.end());
+        printf("%-16s %7u %14.0f %9u %9u %9u %9u\n", Policy::name(), num_threads, ops / elapsed,
+                percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+                percentile(latencies, 99.9));
+    }
+}
+
+static std::vector<unsigned int> parseList(const char* str){
+    std::vector<unsigned int> values;
+    while(*str != '\0'){
+        char* end;
+        unsigned long value = strtoul(str, &end, 10);
+        if(end == str){
+            break;
+        }
+        values.push_back(value);
+        str = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+static bool parseArgs(int argc, char** argv, Config& config){
+    for(int i = 1; i < argc; ++i){
+        const char* arg = argv[i];
+        if(strncmp(arg, "--policy=", 9) == 0){
+            config.policy = arg + 9;
+        } else if(strncmp(arg, "--threads=", 10) == 0){
+            config.threads = parseList(arg + 10);
+        } else if(strncmp(arg, "--keys=", 7) == 0){
+            config.keys = atoi(arg + 7);
+        } else if(strncmp(arg, "--seconds=", 10) == 0){
+            config.seconds = atof(arg + 10);
+        } else if(strncmp(arg, "--mix=", 6) == 0){
+            std::vector<unsigned int> mix = parseList(arg + 6);
+            if(mix.size() != 3 || mix[0] + mix[1] + mix[2] != 100){
+                fprintf(stderr, "--mix takes lookup,insert,remove percentages which sum to 100\n");
+                return false;
+            }
+            config.lookup_percent = mix[0];
+            config.insert_percent = mix[1];
+        } else {
+            fprintf(stderr, "unknown argument %s\n", arg);
+            return false;
+        }
+    }
+    if(config.policy != "all" && config.policy != HandOverHandPolicy::name()
+            && config.policy != CoarseRWLockPolicy::name() && config.policy != OptimisticPolicy::name()
+            && config.policy != LockFreePolicy::name()){
+        fprintf(stderr, "unknown policy %s\n", config.policy.c_str());
+        return false;
+    }
+    if(config.keys <= 0 || config.threads.empty() || config.seconds <= 0){
+        fprintf(stderr, "keys, threads and seconds must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    Config config;
+    if(!parseArgs(argc, argv, config)){
+        return 1;
+    }
+    printf("keys=%d mix=%u/%u/%u seconds=%.2f\n", config.keys, config.lookup_percent, config.insert_percent,
+            100 - config.lookup_percent - config.insert_percent, config.seconds);
+    printf("%-16s %7s %14s %9s %9s %9s %9s\n", "policy", "threads", "ops/sec", "p50(ns)", "p90(ns)", "p99(ns)",
+            "p99.9(ns)");
+    bool all = config.policy == "all";
+    if(all || config.policy == HandOverHandPolicy::name()){
+        run<HandOverHandPolicy>(config);
+    }
+    if(all || config.policy == CoarseRWLockPolicy::name()){
+        run<CoarseRWLockPolicy>(config);
+    }
+    if(all || config.policy == OptimisticPolicy::name()){
+        run<OptimisticPolicy>(config);
+    }
+    if(all || config.policy == LockFreePolicy::name()){
+        run<LockFreePolicy>(config);
+    }
+    return 0;
+}
@@ -2,103 +2,421 @@
 #include <unistd.h>
 #include <cstring>
 #include <sys/mman.h>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include "malloc_stats.h"
+#include "StripedCounter.h"
 
 #define MAX_SIZE 100000000
 #define SBRK_FAIL (void*)(-1)
 #define LARGE_ENOUGH 128
 #define KB 1024
+#define MB (1024*KB)
 #define MMAP_SIZE (128*KB) // 128kb
 #define X64_BIT_IN_BYTES 8
 
+//besides the sbrk heap (the main arena) every core gets an arena of its own,
+//carved from an mmap'd region of ARENA_SIZE bytes which is also aligned to ARENA_SIZE.
+#define ARENA_SIZE (64*MB)
+#define MAX_ARENAS 64
+
+//free blocks smaller than SMALL_BIN_LIMIT get a bin per exact size (multiple of 8),
+//bigger ones are binned by their power of two, split into SUB_BINS ranges each.
+#define SMALL_BIN_LIMIT 1024
+#define SMALL_BIN_LOG 10
+#define NUM_SMALL_BINS (SMALL_BIN_LIMIT / X64_BIT_IN_BYTES)
+#define SUB_BIN_BITS 2
+#define SUB_BINS (1 << SUB_BIN_BITS)
+#define LARGEST_BIN_LOG 26
+#define NUM_BINS (NUM_SMALL_BINS + (LARGEST_BIN_LOG - SMALL_BIN_LOG + 1) * SUB_BINS)
+#define BITS_IN_WORD 64
+#define BIN_MAP_WORDS ((NUM_BINS + BITS_IN_WORD - 1) / BITS_IN_WORD)
+
+//blocks smaller than TCACHE_MAX_SIZE go through the calling thread's cache first,
+//every cache bin holds up to TCACHE_BIN_COUNT blocks of a single size.
+#define TCACHE_MAX_SIZE 1024
+#define TCACHE_BINS (TCACHE_MAX_SIZE / X64_BIT_IN_BYTES)
+#define TCACHE_BIN_COUNT 32
+#define TCACHE_REFILL 8
+
+//objects of up to SLAB_MAX_SIZE bytes are packed in page sized slabs, one size class per 8 bytes.
+//all slabs are carved from a single reserved region, so an object's slab is found by its address.
+#define SLAB_MAX_SIZE 256
+#define SLAB_CLASSES (SLAB_MAX_SIZE / X64_BIT_IN_BYTES)
+#define SLAB_PAGE_SIZE (4*KB)
+#define SLAB_REGION_SIZE (256*MB)
+
+//memory goes back to the system in whole pages. a free top block bigger than TRIM_THRESHOLD is cut down
+//to TOP_PAD bytes, a free block is released once merging makes it reach RELEASE_THRESHOLD bytes.
+//the threshold is well above MMAP_SIZE so freeing a single heap block doesn't pay for a madvise() and the page faults after it.
+#define OS_PAGE_SIZE (4*KB)
+#define TRIM_THRESHOLD (256*KB)
+#define TOP_PAD (64*KB)
+#define RELEASE_THRESHOLD (1*MB)
+
+//flags kept in the high bits of a block's header word, the rest of it is the block's size
+#define FREE_BIT (1UL << 63)
+//the block before this one is free, so its size can be read from the footer right before us
+#define PREV_FREE_BIT (1UL << 62)
+#define NON_MAIN_ARENA_BIT (1UL << 61)
+#define MMAPPED_BIT (1UL << 60)
+//marks the end of an arena, or foreign memory inside the main arena, never handed out
+#define FENCE_BIT (1UL << 59)
+#define SIZE_MASK (FENCE_BIT - 1)
+
+/*
+ * boundary tag layout:
+ * |header|data.............|        used block
+ * |header|next|prev|...|footer|     free block
+ * the header word holds the size of the data and the flags, only free blocks have a footer
+ * (a copy of their size in their last word) so the physical neighbors of a block
+ * are found by address arithmetic.
+ */
 struct MallocMetadata{
-    size_t size;
-    bool is_free;
-    MallocMetadata* next;
-    MallocMetadata* prev;
-    explicit MallocMetadata(size_t size_in, bool is_free_in = false, MallocMetadata* next_in = nullptr
-            , MallocMetadata* prev_in = nullptr) : size(size_in), is_free(is_free_in)
-            , next(next_in), prev(prev_in) {}
+    size_t size_and_flags;
+    //links of the bin the block sits in, they lie over the data so they're valid only while the block is free
+    MallocMetadata* next_free;
+    MallocMetadata* prev_free;
+};
+
+/*
+ * the header of a used block is read by its owner without any lock while the holder of the
+ * arena's lock may update its PREV_FREE_BIT, so headers are always accessed as whole words.
+ */
+static size_t loadHeader(MallocMetadata* pmeta){
+    return __atomic_load_n(&pmeta->size_and_flags, __ATOMIC_RELAXED);
+}
+
+static void storeHeader(MallocMetadata* pmeta, size_t header){
+    __atomic_store_n(&pmeta->size_and_flags, header, __ATOMIC_RELAXED);
+}
+
+/*
+ * the statistics counters have a single writer at a time (the holder of a lock, or the owning thread)
+ * and are read without any lock, so they're updated with a plain load and store.
+ */
+static void statAdd(std::atomic<size_t>& counter, size_t delta){
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+static void statSub(std::atomic<size_t>& counter, size_t delta){
+    counter.store(counter.load(std::memory_order_relaxed) - delta, std::memory_order_relaxed);
+}
+
+#define META_DATA_SIZE sizeof(size_t)
+//a free block must be able to hold its bin links and its footer
+#define MIN_BLOCK_SIZE (2*sizeof(MallocMetadata*) + sizeof(size_t))
+
+/*
+ * an independent heap: its own blocks, bins and lock.
+ * the blocks lie one after the other from "first" up to the fence header at "top".
+ * the main arena grows with sbrk(), the others live at the start of their mmap'd region
+ * and grow by moving "top" towards "end".
+ */
+struct Arena{
+    //protects everything below, and sbrk() itself for the main arena
+    pthread_mutex_t lock;
+    char* first;
+    char* top;
+    char* end;
+    //free blocks segregated by size class, every free block sits in exactly one bin
+    MallocMetadata* bins[NUM_BINS];
+    //bit i is set iff bins[i] isn't empty, lets us find a suitable bin without scanning
+    uint64_t binMap[BIN_MAP_WORDS];
+    //all the blocks between first and top (gaps of foreign memory aside) and the free ones among them
+    std::atomic<size_t> numBlocks;
+    std::atomic<size_t> numBytes;
+    std::atomic<size_t> freeBlocks;
+    std::atomic<size_t> freeBytes;
+
+    explicit Arena(char* first_in = nullptr, char* end_in = nullptr) : first(first_in), top(first_in), end(end_in)
+            , bins(), binMap(), numBlocks(0), numBytes(0), freeBlocks(0), freeBytes(0) {
+        pthread_mutex_init(&lock, nullptr);
+        if(top != nullptr){
+            storeHeader((MallocMetadata*)top, FENCE_BIT);
+        }
+    }
 };
 
-//dummy head of blocks which have been allocated using sbrk()
-static MallocMetadata metaDataHead(0);
+//the arena of the blocks which have been allocated using sbrk()
+static Arena mainArena;
+
+//arenas[0] is the main arena, the rest are created the first time a thread is assigned to them
+static std::atomic<Arena*> arenas[MAX_ARENAS];
+static std::atomic<size_t> numArenas(0);
+
+//protects the creation of arenas
+static pthread_mutex_t arenasLock = PTHREAD_MUTEX_INITIALIZER;
+
+//used for threads which can't tell on which cpu they run
+static std::atomic<size_t> nextArena(0);
+
+//the arena the calling thread allocates from, assigned on its first allocation
+static thread_local Arena* threadArena = nullptr;
+
+//number and total size of the blocks which have been allocated using mmap()
+static std::atomic<size_t> mmapBlocks(0);
+static std::atomic<size_t> mmapBytes(0);
+
+//calls to the system, and the memory taken from it (see MallocStats)
+static std::atomic<size_t> sbrkCalls(0);
+static std::atomic<size_t> mmapCalls(0);
+static std::atomic<size_t> munmapCalls(0);
+static std::atomic<size_t> footprint(0);
+static std::atomic<size_t> peakFootprint(0);
+
+static void footprintAdd(size_t bytes){
+    size_t now = footprint.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = peakFootprint.load(std::memory_order_relaxed);
+    while(now > peak && !peakFootprint.compare_exchange_weak(peak, now, std::memory_order_relaxed)){
+    }
+}
+
+/*
+ * statistics of the threads' caches, striped so threads rarely write the same cache line,
+ * a query sums the stripes without taking any lock.
+ */
+struct TCacheStats{
+    StripedCounter blocks;
+    StripedCounter bytes;
+    //requests by size class (see MallocStats)
+    StripedCounter requests[MALLOC_SIZE_CLASSES];
+};
+
+/*
+ * created on first use, so allocations made by other files' static constructors find it,
+ * and never destroyed since threads may still free while the process exits.
+ */
+static TCacheStats& tcacheStats(){
+    static TCacheStats* stats = new TCacheStats();
+    return *stats;
+}
+
+
+static size_t blockSize(MallocMetadata* pmeta){
+    return loadHeader(pmeta) & SIZE_MASK;
+}
+
+static void setBlockSize(MallocMetadata* pmeta, size_t size){
+    storeHeader(pmeta, (loadHeader(pmeta) & ~SIZE_MASK) | size);
+}
+
+static bool isFree(MallocMetadata* pmeta){
+    return loadHeader(pmeta) & FREE_BIT;
+}
+
+static void* blockData(MallocMetadata* pmeta){
+    return (char*)pmeta + META_DATA_SIZE;
+}
+
+static MallocMetadata* dataBlock(void* p){
+    return (MallocMetadata*)((char*)p - META_DATA_SIZE);
+}
+
+static MallocMetadata* nextBlock(MallocMetadata* pmeta){
+    return (MallocMetadata*)((char*)blockData(pmeta) + blockSize(pmeta));
+}
+
+/*
+ * must be called only if the block has PREV_FREE_BIT, otherwise there's no footer to read.
+ */
+static MallocMetadata* prevBlock(MallocMetadata* pmeta){
+    size_t prev_size = *((size_t*)pmeta - 1);
+    return (MallocMetadata*)((char*)pmeta - prev_size - META_DATA_SIZE);
+}
+
+/*
+ * returns the bin that a free block of size "size" belongs to.
+ */
+static size_t binIndex(size_t size){
+    if(size < SMALL_BIN_LIMIT){
+        return size / X64_BIT_IN_BYTES;
+    }
+    size_t log = BITS_IN_WORD - 1 - __builtin_clzl(size);
+    if(log > LARGEST_BIN_LOG){
+        //everything above the largest class shares the last bin
+        return NUM_BINS - 1;
+    }
+    size_t sub = (size >> (log - SUB_BIN_BITS)) & (SUB_BINS - 1);
+    return NUM_SMALL_BINS + (log - SMALL_BIN_LOG) * SUB_BINS + sub;
+}
+
+/*
+ * returns true if every block in binIndex(size) is large enough for "size",
+ * which is the case when size is the smallest size of its bin.
+ */
+static bool isBinLowerBound(size_t size){
+    if(size < SMALL_BIN_LIMIT){
+        return true;
+    }
+    size_t log = BITS_IN_WORD - 1 - __builtin_clzl(size);
+    if(log > LARGEST_BIN_LOG){
+        return false;
+    }
+    return (size & ((1UL << (log - SUB_BIN_BITS)) - 1)) == 0;
+}
+
+static void binInsert(Arena* arena, MallocMetadata* pmeta){
+    size_t i = binIndex(blockSize(pmeta));
+    pmeta->prev_free = nullptr;
+    pmeta->next_free = arena->bins[i];
+    if(arena->bins[i] != nullptr){
+        arena->bins[i]->prev_free = pmeta;
+    }
+    arena->bins[i] = pmeta;
+    arena->binMap[i / BITS_IN_WORD] |= 1UL << (i % BITS_IN_WORD);
+    statAdd(arena->freeBlocks, 1);
+    statAdd(arena->freeBytes, blockSize(pmeta));
+}
 
-//dummy head of blocks which have been allocated using mmap()
-static MallocMetadata mmapDataHead(0);
+static void binRemove(Arena* arena, MallocMetadata* pmeta){
+    size_t i = binIndex(blockSize(pmeta));
+    if(pmeta->prev_free != nullptr){
+        pmeta->prev_free->next_free = pmeta->next_free;
+    } else {
+        arena->bins[i] = pmeta->next_free;
+    }
+    if(pmeta->next_free != nullptr){
+        pmeta->next_free->prev_free = pmeta->prev_free;
+    }
+    if(arena->bins[i] == nullptr){
+        arena->binMap[i / BITS_IN_WORD] &= ~(1UL << (i % BITS_IN_WORD));
+    }
+    statSub(arena->freeBlocks, 1);
+    statSub(arena->freeBytes, blockSize(pmeta));
+}
 
+/*
+ * returns the first non-empty bin whose index is at least "from",
+ * NUM_BINS is returned if there isn't any.
+ */
+static size_t nextNonEmptyBin(Arena* arena, size_t from){
+    size_t word = from / BITS_IN_WORD;
+    if(word >= BIN_MAP_WORDS){
+        return NUM_BINS;
+    }
+    uint64_t bits = arena->binMap[word] & (~0UL << (from % BITS_IN_WORD));
+    while(bits == 0){
+        if(++word == BIN_MAP_WORDS){
+            return NUM_BINS;
+        }
+        bits = arena->binMap[word];
+    }
+    return word * BITS_IN_WORD + __builtin_ctzl(bits);
+}
+
+/*
+ * finds a free block which is at least "size" big, removes it from its bin and returns it.
+ * any block of a bin above binIndex(size) is big enough, so the common case is a bitmap lookup
+ * and taking the head of that bin. only if all of them are empty the bin of "size" itself is
+ * scanned, as some of its blocks may still fit.
+ * returns nullptr if there's no such block.
+ */
+static MallocMetadata* findFreeBlock(Arena* arena, size_t size){
+    size_t i = binIndex(size);
+    size_t first_fit = nextNonEmptyBin(arena, isBinLowerBound(size) ? i : i + 1);
+    if(first_fit != NUM_BINS){
+        MallocMetadata* pmeta = arena->bins[first_fit];
+        binRemove(arena, pmeta);
+        return pmeta;
+    }
+    for(MallocMetadata* it = arena->bins[i]; it != nullptr; it = it->next_free){
+        if(blockSize(it) >= size){
+            binRemove(arena, it);
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * marks the block as free: writes its footer, tells the next block about it and puts it in its bin.
+ * the block is expected to be merged with its neighbors already.
+ */
+static void makeFree(Arena* arena, MallocMetadata* pmeta){
+    storeHeader(pmeta, loadHeader(pmeta) | FREE_BIT);
+    MallocMetadata* next = nextBlock(pmeta);
+    *((size_t*)next - 1) = blockSize(pmeta);
+    storeHeader(next, loadHeader(next) | PREV_FREE_BIT);
+    binInsert(arena, pmeta);
+}
+
+/*
+ * marks a block, which is already out of its bin, as used.
+ */
+static void makeUsed(MallocMetadata* pmeta){
+    storeHeader(pmeta, loadHeader(pmeta) & ~FREE_BIT);
+    MallocMetadata* next = nextBlock(pmeta);
+    storeHeader(next, loadHeader(next) & ~PREV_FREE_BIT);
+}
 
 static bool check_if_splittable(MallocMetadata* pmeta, size_t size){
-    return pmeta->size >= LARGE_ENOUGH + size + sizeof(MallocMetadata);
+    return blockSize(pmeta) >= LARGE_ENOUGH + size + META_DATA_SIZE;
 }
 
+static MallocMetadata* metaDataMergerNext(Arena* arena, MallocMetadata* p);
+
 /*
  * this function checks if split is possible and if its then
  * it splits the block into 2 separate blocks each with Metadata of its own
- * in either case it returns pmeta, if non-free block was sent nullptr is returned.
+ * pmeta is expected to be out of its bin and to stay (or become) used, the new free block
+ * is merged with the block after it if possible and put in its bin.
+ * in either case it returns pmeta.
  */
-static void* splitter(void* p, size_t size){
-    //for ease of use
-    auto* pmeta = (MallocMetadata*)p;
-    //we can't split blocks that aren't free
-    if (!pmeta->is_free){
-        return nullptr;
-    }
+static MallocMetadata* splitter(Arena* arena, MallocMetadata* pmeta, size_t size){
     //if we can't split the block nothing more to do and we return pmeta
     if(!check_if_splittable(pmeta, size)){
         return pmeta;
     }
 
-    //if the block is splittable we will create new MallocMetadata for it in the beggining
-    //of the new splitted block
-    void* new_p = (void*)((char*)p+sizeof(MallocMetadata)+size);
-    //for ease of use
-    auto* new_node = (MallocMetadata*)new_p;
-    *new_node = MallocMetadata(pmeta->size - sizeof(MallocMetadata) - size);
-    // |--pmeta--|<->|--next--| => |--pmeta--|<-|--new_node--|  (from pmeta)->|--next--|
-    new_node->prev = pmeta;
-    // |--pmeta--|<-|--new_node--|  (from pmeta)->|--next--| => |--pmeta--|<-|--new_node--|->|--next--|
-    new_node->next = pmeta->next;
-    // |--pmeta--|<-|--new_node--|->|--next--| => |--pmeta--|<-|--new_node--|<->|--next--|
-    if(new_node->next != nullptr){
-        new_node->next->prev = new_node;
-    }
-    // |--pmeta--|<-|--new_node--|<->|--next--| => |--pmeta--|<->|--new_node--|<->|--next--|
-    pmeta->next = new_node;
-
-
-    pmeta->size = size;
-    pmeta->next->is_free = true;
+    size_t rest = blockSize(pmeta) - size - META_DATA_SIZE;
+    setBlockSize(pmeta, size);
+
+    //the header of the new block lies right after pmeta's (now smaller) data
+    // |--pmeta------------|--next--| => |--pmeta--|--new_node--|--next--|
+    MallocMetadata* new_node = nextBlock(pmeta);
+    storeHeader(new_node, rest | (loadHeader(pmeta) & NON_MAIN_ARENA_BIT));
+    //one more block, and one more header out of the bytes
+    statAdd(arena->numBlocks, 1);
+    statSub(arena->numBytes, META_DATA_SIZE);
+
+    makeFree(arena, metaDataMergerNext(arena, new_node));
     return pmeta;
 }
 
-static MallocMetadata* metaDataMergerNext(MallocMetadata* p){
-    //in case there's a next block and it's free we will simply merge it into block p
-    //and remove the p->next block
-    if(p->next != nullptr && p->next->is_free){
-        //we're freeing both the data segment (size) and also the metadata segment
-        // |-p-|<->|-next-|<->|-next-|  => |-p-|-next-||<->|-next-|<->|-next-|
-        p->size += sizeof(MallocMetadata) + p->next->size;
-        if(p->next->next != nullptr){
-            //|-p-|-next-||<->|-next-|
-            p->next->next->prev = p;
-        }
-        //|-p-|-next-||->|-next-|
-        p->next = p->next->next;
+/*
+ * the merged-in neighbor is taken out of its bin, but p's own state isn't touched
+ * so the caller has to call makeFree/makeUsed on the result.
+ */
+static MallocMetadata* metaDataMergerNext(Arena* arena, MallocMetadata* p){
+    //in case the next block is free we will simply merge it into block p,
+    //the fence at the end of the arena is never free so there's always a next block to look at
+    MallocMetadata* next = nextBlock(p);
+    if(isFree(next)){
+        binRemove(arena, next);
+        //we're taking both the data segment and also the header of next
+        // |-p-|-next-|-next-| => |-p-|-next-||-next-|
+        setBlockSize(p, blockSize(p) + META_DATA_SIZE + blockSize(next));
+        statSub(arena->numBlocks, 1);
+        statAdd(arena->numBytes, META_DATA_SIZE);
     }
     return p;
 }
 
-static MallocMetadata* metaDataMergerPrev(MallocMetadata* p){
-    if(p->prev != &metaDataHead && p->prev->is_free){
-        //we want to merge p into p->prev!
-        p->prev->size += sizeof(MallocMetadata) + p->size;
-
-        p->prev->next = p->next;
-        if(p->next != nullptr){
-            p->next->prev = p->prev;
-        }
-        //at this point p isn't referenced by any block and we can release the pointer
-        p = p->prev;
+static MallocMetadata* metaDataMergerPrev(Arena* arena, MallocMetadata* p){
+    if(loadHeader(p) & PREV_FREE_BIT){
+        MallocMetadata* prev = prevBlock(p);
+        binRemove(arena, prev);
+        //we want to merge p into prev!
+        setBlockSize(prev, blockSize(prev) + META_DATA_SIZE + blockSize(p));
+        statSub(arena->numBlocks, 1);
+        statAdd(arena->numBytes, META_DATA_SIZE);
+        //at this point p isn't part of any block
+        p = prev;
     }
     return p;
 }
@@ -107,145 +425,901 @@ static MallocMetadata* metaDataMergerPrev(MallocMetadata* p){
  * this function checks if next or prev blocks are free and
  * if they're then we will merge them into our block and return the pointer
  * to the beginning of the metadata of the new big block.
- * if the current block isn't free then we'll return nullptr.
+ * like metaDataMergerNext/Prev the merged block isn't marked or put in a bin.
+ */
+static MallocMetadata* metaDataMerger(Arena* arena, MallocMetadata* p){
+    p = metaDataMergerNext(arena, p);
+
+    return metaDataMergerPrev(arena, p);
+}
+
+static size_t alignToEight(size_t size){
+    if((size % X64_BIT_IN_BYTES) == 0) return 0;
+    return X64_BIT_IN_BYTES - (size % X64_BIT_IN_BYTES);
+}
+
+/*
+ * the size of the block which serves a request of "size" bytes.
+ */
+static size_t adjustSize(size_t size){
+    size += alignToEight(size);
+    return size < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : size;
+}
+
+/*
+ * adds "increment" bytes at the end of the arena and moves the fence after them.
+ * returns where the added memory starts, which is the old fence's address unless sbrk()
+ * skipped over memory somebody else took since our last call. in that case the old fence
+ * becomes a used block covering the foreign memory, so the arena stays walkable.
+ * returns nullptr if the arena can't grow.
  */
-static void* metaDataMerger(MallocMetadata* p){
-    //if the block isn't free we can't merge it with other blocks
-    if(!p->is_free){
+static char* arenaGrow(Arena* arena, size_t increment){
+    char* start = arena->top;
+    if(arena == &mainArena){
+        if(arena->top == nullptr){
+            //the very first call, the heap starts with just the fence
+            void* ret = sbrk(0);
+            sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+            if(ret == SBRK_FAIL){
+                return nullptr;
+            }
+            sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+            if(sbrk(alignToEight((uintptr_t)ret) + META_DATA_SIZE) == SBRK_FAIL){
+                return nullptr;
+            }
+            footprintAdd(alignToEight((uintptr_t)ret) + META_DATA_SIZE);
+            arena->first = arena->top = start = (char*)ret + alignToEight((uintptr_t)ret);
+            storeHeader((MallocMetadata*)start, FENCE_BIT);
+        }
+        void* ret = sbrk(increment);
+        sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+        if(ret == SBRK_FAIL){
+            return nullptr;
+        }
+        footprintAdd(increment);
+        if((char*)ret != arena->top + META_DATA_SIZE){
+            //a new fence is needed after the new memory
+            sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+            if(sbrk(META_DATA_SIZE) != (char*)ret + increment){
+                return nullptr;
+            }
+            footprintAdd(META_DATA_SIZE);
+            auto* gap = (MallocMetadata*)arena->top;
+            storeHeader(gap, (loadHeader(gap) & PREV_FREE_BIT) | FENCE_BIT
+                    | ((char*)ret - arena->top - META_DATA_SIZE));
+            start = (char*)ret;
+        }
+    } else if((size_t)(arena->end - arena->top) < increment + META_DATA_SIZE){
         return nullptr;
+    } else {
+        footprintAdd(increment);
     }
+    arena->top = start + increment;
+    storeHeader((MallocMetadata*)arena->top, FENCE_BIT);
+    return start;
+}
 
-    p = metaDataMergerNext(p);
+/*
+ * returns the last block of the arena if it's free (the "wilderness"), nullptr otherwise.
+ */
+static MallocMetadata* wilderness(Arena* arena){
+    if(arena->top == nullptr){
+        return nullptr;
+    }
+    auto* fence = (MallocMetadata*)arena->top;
+    return (loadHeader(fence) & PREV_FREE_BIT) ? prevBlock(fence) : nullptr;
+}
 
-    return metaDataMergerPrev(p);
+/*
+ * makes the memory which arenaGrow() added after a gap part of the arena: as a free block
+ * if it's big enough, otherwise the gap block before it (the old fence) swallows it.
+ */
+static void adoptGrownMemory(Arena* arena, char* old_top, char* start, size_t increment){
+    if(increment >= META_DATA_SIZE + MIN_BLOCK_SIZE){
+        auto* pmeta = (MallocMetadata*)start;
+        storeHeader(pmeta, (increment - META_DATA_SIZE) | (arena != &mainArena ? NON_MAIN_ARENA_BIT : 0));
+        statAdd(arena->numBlocks, 1);
+        statAdd(arena->numBytes, increment - META_DATA_SIZE);
+        makeFree(arena, pmeta);
+        return;
+    }
+    auto* gap = (MallocMetadata*)old_top;
+    setBlockSize(gap, blockSize(gap) + increment);
 }
 
 /*
  * receives a pointer to the top block metadata and enlarging it to to size of "size".
- * will return nullptr if metaDataHead/nullptr was sent or if pmeta block isn't free.
+ * will return nullptr if the arena couldn't grow right after the block.
+ * pmeta is expected to be free and out of its bin already.
  */
-static void* expandTopBlock(MallocMetadata* pmeta, size_t size){
-    //we can't enlarge the top block if it isn't free or if nullptr was sent
-    //the compare to metaDataHead should always fail since we can't expand the dummy node!
-    if(pmeta == nullptr || !pmeta->is_free || pmeta == &metaDataHead){
-        return nullptr;
-    }
+static MallocMetadata* expandTopBlock(Arena* arena, MallocMetadata* pmeta, size_t size){
     //we need to add to the top block only the difference between the wanted size
     //and the already available size
-    if(sbrk(size-pmeta->size) == SBRK_FAIL){
+    size_t increment = size - blockSize(pmeta);
+    char* start = arenaGrow(arena, increment);
+    if(start == nullptr){
+        return nullptr;
+    }
+    if(start != (char*)nextBlock(pmeta)){
+        adoptGrownMemory(arena, (char*)nextBlock(pmeta), start, increment);
         return nullptr;
     }
 
     //updated the new size of the block
-    pmeta->size = size;
+    setBlockSize(pmeta, size);
+    statAdd(arena->numBytes, increment);
 
-    return (void*)pmeta;
-}
-
-
-static size_t alignToEight(size_t size){
-    if((size % X64_BIT_IN_BYTES) == 0) return 0;
-    return X64_BIT_IN_BYTES - (size % X64_BIT_IN_BYTES);
+    return pmeta;
 }
 
 /*
  * creates new area for the requested size
- * updates the mmap linked list
  * returns the address after the metadata
  */
 static void* smmap(size_t size){
     //creating new area in memory using mmap with extra space for metadata
-    void* p = mmap(nullptr, size + sizeof(MallocMetadata), PROT_READ | PROT_WRITE,
+    void* p = mmap(nullptr, size + META_DATA_SIZE, PROT_READ | PROT_WRITE,
             MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+    mmapCalls.fetch_add(1, std::memory_order_relaxed);
+    if(p == MAP_FAILED){
+        return nullptr;
+    }
 
     //using the beginning of the memory for saving the metadata
     auto* new_node = (MallocMetadata*)p;
-    *new_node = MallocMetadata(size);
+    storeHeader(new_node, size | MMAPPED_BIT);
+    ++mmapBlocks;
+    mmapBytes += size;
+    footprintAdd(size + META_DATA_SIZE);
+
+    return blockData(new_node);
+}
+
+static void smunmap(MallocMetadata* pmeta){
+    --mmapBlocks;
+    mmapBytes -= blockSize(pmeta);
+    footprint.fetch_sub(blockSize(pmeta) + META_DATA_SIZE, std::memory_order_relaxed);
+    munmapCalls.fetch_add(1, std::memory_order_relaxed);
+    munmap((void*)pmeta, blockSize(pmeta) + META_DATA_SIZE);
+}
+
+/*
+ * creates a new arena at the beginning of an ARENA_SIZE aligned mmap'd region.
+ * returns nullptr if the region couldn't be mapped.
+ */
+static Arena* arenaCreate(){
+    //mapping twice the size so an aligned region can be cut out of it
+    void* p = mmap(nullptr, 2 * ARENA_SIZE, PROT_READ | PROT_WRITE,
+            MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    mmapCalls.fetch_add(1, std::memory_order_relaxed);
+    if(p == MAP_FAILED){
+        return nullptr;
+    }
+    char* region = (char*)(((uintptr_t)p + ARENA_SIZE - 1) & ~((uintptr_t)ARENA_SIZE - 1));
+    if(region != (char*)p){
+        munmap(p, region - (char*)p);
+        munmapCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+    munmap(region + ARENA_SIZE, (char*)p + ARENA_SIZE - region);
+    munmapCalls.fetch_add(1, std::memory_order_relaxed);
+    //the arena's header and first fence are touched right away
+    footprintAdd(sizeof(Arena) + alignToEight(sizeof(Arena)) + META_DATA_SIZE);
+
+    //blocks start right after the arena itself
+    char* first = region + sizeof(Arena) + alignToEight(sizeof(Arena));
+    return new (region) Arena(first, region + ARENA_SIZE);
+}
+
+static size_t arenaCount(){
+    size_t n = numArenas.load(std::memory_order_acquire);
+    if(n != 0){
+        return n;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    n = cpus < 1 ? 1 : (cpus > MAX_ARENAS ? MAX_ARENAS : (size_t)cpus);
+    arenas[0].store(&mainArena, std::memory_order_release);
+    numArenas.store(n, std::memory_order_release);
+    return n;
+}
 
-    //finding the last node in mmap linked list
-    MallocMetadata* pmet = &mmapDataHead;
-    while(pmet != nullptr){
-        if(pmet->next == nullptr) break;
-        pmet = pmet->next;
+/*
+ * returns the arena of the calling thread, on the first call the thread is assigned
+ * the arena of the cpu it runs on (round-robin if the cpu is unknown).
+ * the main arena is used if a new arena couldn't be created.
+ */
+static Arena* getThreadArena(){
+    if(threadArena != nullptr){
+        return threadArena;
+    }
+    size_t n = arenaCount();
+    int cpu = sched_getcpu();
+    size_t i = (cpu >= 0 ? (size_t)cpu : nextArena++) % n;
+
+    Arena* arena = arenas[i].load(std::memory_order_acquire);
+    if(arena == nullptr){
+        pthread_mutex_lock(&arenasLock);
+        arena = arenas[i].load(std::memory_order_relaxed);
+        if(arena == nullptr){
+            arena = arenaCreate();
+            if(arena != nullptr){
+                arenas[i].store(arena, std::memory_order_release);
+            }
+        }
+        pthread_mutex_unlock(&arenasLock);
+    }
+    threadArena = arena != nullptr ? arena : &mainArena;
+    return threadArena;
+}
+
+/*
+ * returns the arena which pmeta was allocated from.
+ */
+static Arena* arenaOf(MallocMetadata* pmeta){
+    if(!(loadHeader(pmeta) & NON_MAIN_ARENA_BIT)){
+        return &mainArena;
+    }
+    return (Arena*)((uintptr_t)pmeta & ~((uintptr_t)ARENA_SIZE - 1));
+}
+
+/*
+ * allocates a block of "size" bytes (already adjusted) from the arena.
+ * the arena's lock must be held.
+ */
+static MallocMetadata* heapAlloc(Arena* arena, size_t size){
+    //check if the requested size can be fitted in a free'd allocated block
+    MallocMetadata* it = findFreeBlock(arena, size);
+    if(it != nullptr){
+        splitter(arena, it, size);
+        makeUsed(it);
+        return it;
+    }
+
+    it = wilderness(arena);
+    if(it != nullptr){
+        //if we're here then for sure it's smaller than size ; so we can just enlarge this block
+        binRemove(arena, it);
+        if(expandTopBlock(arena, it, size) != nullptr){
+            makeUsed(it);
+            return it;
+        }
+        //put it back, if the arena did grow (after a gap) the new memory may be enough now
+        binInsert(arena, it);
+        return wilderness(arena) != it ? heapAlloc(arena, size) : nullptr;
+    }
+
+    char* old_top = arena->top;
+    char* ret = arenaGrow(arena, size + META_DATA_SIZE);
+
+    if(ret == nullptr)
+        return nullptr;
+
+    if(old_top != nullptr && ret != old_top){
+        adoptGrownMemory(arena, old_top, ret, size + META_DATA_SIZE);
+        return heapAlloc(arena, size);
     }
 
-    //connecting the new_node to the end of the list
-    pmet->next = new_node;
-    new_node->prev = pmet;
+    auto* metaData = (MallocMetadata*)ret;
+    storeHeader(metaData, size | (arena != &mainArena ? NON_MAIN_ARENA_BIT : 0));
+    statAdd(arena->numBlocks, 1);
+    statAdd(arena->numBytes, size);
 
-    return new_node+1;
+    return metaData;
 }
 
-static void smunmap(MallocMetadata* pmeta){
-    //disconnecting pmeta from mmap linked list
-    pmeta->prev->next = pmeta->next;
-    if(pmeta->next != nullptr){
-        pmeta->next->prev = pmeta->prev;
+static char* pageDown(char* p){
+    return (char*)((uintptr_t)p & ~((uintptr_t)OS_PAGE_SIZE - 1));
+}
+
+static char* pageUp(char* p){
+    return pageDown(p + OS_PAGE_SIZE - 1);
+}
+
+/*
+ * gives the whole pages of a free block which lie within [from, to) back to the system.
+ * the bin links at the start of the data and the footer at its end are kept, the rest of the data
+ * reads as zeros once it's touched again. returns true if any page was released.
+ */
+static bool releaseFreeBlock(MallocMetadata* pmeta, char* from, char* to){
+    char* start = pageUp(std::max((char*)(&pmeta->prev_free + 1), from));
+    char* end = pageDown(std::min((char*)nextBlock(pmeta) - sizeof(size_t), to));
+    if(start >= end){
+        return false;
     }
+    return madvise(start, end - start, MADV_DONTNEED) == 0;
+}
 
-    munmap((void*)pmeta, pmeta->size + sizeof(MallocMetadata));
+/*
+ * cuts the free top block of the arena down to "pad" bytes, rounded up so the arena ends on a page.
+ * the main arena gives the memory back with a negative sbrk() (unless someone else moved the break since
+ * our last call), the others release the pages and grow over them again when needed.
+ * returns true if anything was given back.
+ * the arena's lock must be held.
+ */
+static bool arenaTrim(Arena* arena, size_t pad){
+    MallocMetadata* top_block = wilderness(arena);
+    if(top_block == nullptr){
+        return false;
+    }
+    char* old_end = arena->top + META_DATA_SIZE;
+    char* new_end = pageUp((char*)blockData(top_block) + std::max(pad, (size_t)MIN_BLOCK_SIZE) + META_DATA_SIZE);
+    if(new_end >= old_end || (size_t)(old_end - new_end) < OS_PAGE_SIZE){
+        return false;
+    }
+    size_t amount = old_end - new_end;
+    if(arena == &mainArena){
+        void* cur_end = sbrk(0);
+        sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+        if(cur_end != old_end){
+            return false;
+        }
+        sbrkCalls.fetch_add(1, std::memory_order_relaxed);
+        if(sbrk(-(intptr_t)amount) == SBRK_FAIL){
+            return false;
+        }
+    } else {
+        madvise(new_end, pageDown(old_end) - new_end, MADV_DONTNEED);
+    }
+    binRemove(arena, top_block);
+    setBlockSize(top_block, blockSize(top_block) - amount);
+    arena->top -= amount;
+    storeHeader((MallocMetadata*)arena->top, FENCE_BIT);
+    makeFree(arena, top_block);
+    statSub(arena->numBytes, amount);
+    footprint.fetch_sub(amount, std::memory_order_relaxed);
+    return true;
 }
 
-void* smalloc(size_t size){
+/*
+ * returns a block to its arena, merging it with its free neighbors.
+ * a big enough result is trimmed if it's at the top of the arena. otherwise the whole block is released
+ * the first time it reaches RELEASE_THRESHOLD, after that only a freed block which is that big by itself is.
+ * smaller blocks freed into an already released one keep their pages until it's reused or strim() runs,
+ * so a program which keeps allocating and freeing next to a big free block doesn't fault its pages back every time.
+ * the arena's lock must be held.
+ */
+static void heapFree(Arena* arena, MallocMetadata* pmeta){
+    char* freed_start = (char*)pmeta;
+    char* freed_end = (char*)nextBlock(pmeta);
+    //the neighbors are looked at before merging, a free one of RELEASE_THRESHOLD bytes has been released already
+    bool was_released = false;
+    MallocMetadata* next = nextBlock(pmeta);
+    if(isFree(next) && blockSize(next) >= RELEASE_THRESHOLD){
+        was_released = true;
+    }
+    if((loadHeader(pmeta) & PREV_FREE_BIT) && blockSize(prevBlock(pmeta)) >= RELEASE_THRESHOLD){
+        was_released = true;
+    }
+    MallocMetadata* merged = metaDataMerger(arena, pmeta);
+    makeFree(arena, merged);
+    //TRIM_THRESHOLD is below RELEASE_THRESHOLD, so the top is looked at first
+    if((char*)nextBlock(merged) == arena->top && blockSize(merged) > TRIM_THRESHOLD && arenaTrim(arena, TOP_PAD)){
+        return;
+    }
+    if(blockSize(merged) < RELEASE_THRESHOLD){
+        return;
+    }
+    if(!was_released){
+        releaseFreeBlock(merged, (char*)merged, (char*)nextBlock(merged));
+    } else if(freed_end - freed_start >= RELEASE_THRESHOLD){
+        releaseFreeBlock(merged, freed_start, freed_end);
+    }
+}
 
-    //check for invalid input
-    if(size == 0 || size > MAX_SIZE){
+/*
+ * allocates from the calling thread's arena, falling back to the main arena
+ * once the thread's arena region is used up.
+ */
+static MallocMetadata* arenaAlloc(size_t size){
+    Arena* arena = getThreadArena();
+    pthread_mutex_lock(&arena->lock);
+    MallocMetadata* pmeta = heapAlloc(arena, size);
+    pthread_mutex_unlock(&arena->lock);
+    if(pmeta == nullptr && arena != &mainArena){
+        pthread_mutex_lock(&mainArena.lock);
+        pmeta = heapAlloc(&mainArena, size);
+        pthread_mutex_unlock(&mainArena.lock);
+    }
+    return pmeta;
+}
+
+/*
+ * tries to resize the block in place or by merging it with its neighbors.
+ * returns the (possibly moved) data address, or nullptr if a new block is needed.
+ * the arena's lock must be held.
+ */
+static void* heapRealloc(Arena* arena, MallocMetadata* pmeta, size_t size){
+    void* oldp = blockData(pmeta);
+    //only the old content has to be moved when the block is merged with its neighbors
+    size_t old_size = blockSize(pmeta);
+    MallocMetadata* next = nextBlock(pmeta);
+    size_t prev_size = (loadHeader(pmeta) & PREV_FREE_BIT) ? blockSize(prevBlock(pmeta)) : 0;
+    size_t next_size = isFree(next) ? blockSize(next) : 0;
+
+    //checks if the wanted new size is smaller than than older size then no need to do nothing
+    //as the old block is large enough
+    if(old_size >= size){
+        splitter(arena, pmeta, size);
+        return oldp;
+    }
+
+
+    //if the block is "wilderness" we need only to enlarge the arena
+    if((char*)next == arena->top){
+        char* start = arenaGrow(arena, size - old_size);
+        if(start == nullptr){
+            return nullptr;
+        }
+        if(start != (char*)next){
+            adoptGrownMemory(arena, (char*)next, start, size - old_size);
+            return nullptr;
+        }
+        setBlockSize(pmeta, size);
+        statAdd(arena->numBytes, size - old_size);
+        return oldp;
+    }
+
+    //checking if merging with prev block is enough
+    if(prev_size != 0 && old_size + prev_size + META_DATA_SIZE >= size){
+        pmeta = metaDataMergerPrev(arena, pmeta);
+        makeUsed(pmeta);
+        //in case we merged with block which is too big
+        std::memmove(blockData(pmeta), oldp, old_size);
+        return blockData(splitter(arena, pmeta, size));
+    }
+
+    //checking if merging with next block is enough
+    if(next_size != 0 && old_size + next_size + META_DATA_SIZE >= size){
+        pmeta = metaDataMergerNext(arena, pmeta);
+        makeUsed(pmeta);
+        //in case we merged with block which is too big
+        splitter(arena, pmeta, size);
+        return oldp;
+    }
+
+    //checking if merging with both next and prev is enough
+    if(prev_size != 0 && next_size != 0
+        && old_size + prev_size + next_size + (2*META_DATA_SIZE) >= size){
+        pmeta = metaDataMergerPrev(arena, pmeta);
+        pmeta = metaDataMergerNext(arena, pmeta);
+        makeUsed(pmeta);
+        //in case we merged with block which is too big
+        std::memmove(blockData(pmeta), oldp, old_size);
+        return blockData(splitter(arena, pmeta, size));
+    }
+
+    return nullptr;
+}
+
+/*
+ * a slab is a page serving objects of a single size class, with its header at the start of the page.
+ * objects carry no header of their own: every page of the slab region is a slab, so the slab
+ * of an object is found by aligning its address down to the page.
+ */
+struct Slab{
+    //freed slots, chained through their first word
+    void* free_list;
+    //slots from here to the end of the page have never been handed out
+    char* unused;
+    size_t object_size;
+    unsigned int used;
+    unsigned int capacity;
+    //links in the partial list of the size class
+    Slab* next;
+    Slab* prev;
+};
+
+struct SlabClass{
+    pthread_mutex_t lock;
+    //slabs which have at least one free slot
+    Slab* partial;
+    //objects handed out of the class's slabs (including those sitting in threads' caches) and slabs
+    std::atomic<size_t> objects;
+    std::atomic<size_t> slabs;
+};
+
+//slabs[i] serves objects of i*8 bytes
+static SlabClass slabClasses[SLAB_CLASSES + 1];
+static pthread_once_t slabClassesOnce = PTHREAD_ONCE_INIT;
+
+//the reserved region all slabs are carved from, nullptr until the first slab is needed
+static std::atomic<char*> slabRegion(nullptr);
+static char* slabRegionTop = nullptr;
+static bool slabRegionFailed = false;
+//pages of slabs which became empty, chained through their first word
+static void* slabFreePages = nullptr;
+
+//protects the fields of the slab region
+static pthread_mutex_t slabRegionLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void slabClassesInit(){
+    for(size_t i = 0 ; i <= SLAB_CLASSES ; ++i){
+        pthread_mutex_init(&slabClasses[i].lock, nullptr);
+    }
+}
+
+static bool inSlabRegion(void* p){
+    char* region = slabRegion.load(std::memory_order_acquire);
+    return region != nullptr && (char*)p >= region && (char*)p < region + SLAB_REGION_SIZE;
+}
+
+static Slab* slabOf(void* p){
+    return (Slab*)((uintptr_t)p & ~((uintptr_t)SLAB_PAGE_SIZE - 1));
+}
+
+/*
+ * takes a page of the slab region (reserving the region on the first call) and makes it a slab
+ * of "size" bytes objects. returns nullptr if the region is used up or couldn't be reserved.
+ */
+static Slab* slabCreate(size_t size){
+    char* page = nullptr;
+    pthread_mutex_lock(&slabRegionLock);
+    if(slabFreePages != nullptr){
+        page = (char*)slabFreePages;
+        slabFreePages = *(void**)page;
+    } else {
+        if(slabRegion.load(std::memory_order_relaxed) == nullptr && !slabRegionFailed){
+            void* region = mmap(nullptr, SLAB_REGION_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+            mmapCalls.fetch_add(1, std::memory_order_relaxed);
+            if(region == MAP_FAILED){
+                slabRegionFailed = true;
+            } else {
+                slabRegionTop = (char*)region;
+                slabRegion.store((char*)region, std::memory_order_release);
+            }
+        }
+        char* region = slabRegion.load(std::memory_order_relaxed);
+        if(region != nullptr && slabRegionTop < region + SLAB_REGION_SIZE){
+            page = slabRegionTop;
+            slabRegionTop += SLAB_PAGE_SIZE;
+            footprintAdd(SLAB_PAGE_SIZE);
+        }
+    }
+    pthread_mutex_unlock(&slabRegionLock);
+    if(page == nullptr){
         return nullptr;
     }
 
-    size += alignToEight(size);
+    auto* slab = (Slab*)page;
+    slab->free_list = nullptr;
+    slab->unused = page + sizeof(Slab);
+    slab->object_size = size;
+    slab->used = 0;
+    slab->capacity = (SLAB_PAGE_SIZE - sizeof(Slab)) / size;
+    slab->next = slab->prev = nullptr;
+    return slab;
+}
 
-    MallocMetadata* it;
+static void slabListRemove(SlabClass* cls, Slab* slab){
+    if(slab->prev != nullptr){
+        slab->prev->next = slab->next;
+    } else {
+        cls->partial = slab->next;
+    }
+    if(slab->next != nullptr){
+        slab->next->prev = slab->prev;
+    }
+    slab->next = slab->prev = nullptr;
+}
 
-    if(size >= MMAP_SIZE){
-        it = &mmapDataHead;
-        return smmap(size);
+static void slabListPush(SlabClass* cls, Slab* slab){
+    slab->prev = nullptr;
+    slab->next = cls->partial;
+    if(cls->partial != nullptr){
+        cls->partial->prev = slab;
+    }
+    cls->partial = slab;
+}
+
+/*
+ * takes a free slot of the class, a new slab is created only if may_grow is set.
+ * the class's lock must be held.
+ */
+static void* slabAllocLocked(SlabClass* cls, size_t size, bool may_grow){
+    Slab* slab = cls->partial;
+    if(slab == nullptr){
+        if(!may_grow || (slab = slabCreate(size)) == nullptr){
+            return nullptr;
+        }
+        statAdd(cls->slabs, 1);
+        slabListPush(cls, slab);
+    }
+    void* p;
+    if(slab->free_list != nullptr){
+        p = slab->free_list;
+        slab->free_list = *(void**)p;
+    } else {
+        p = slab->unused;
+        slab->unused += size;
+    }
+    if(++slab->used == slab->capacity){
+        slabListRemove(cls, slab);
+    }
+    statAdd(cls->objects, 1);
+    return p;
+}
+
+/*
+ * gives a slot back to its slab, a slab which becomes empty returns its page to the region
+ * unless it's the only partial slab of its class.
+ * the class's lock must be held.
+ */
+static void slabFreeLocked(SlabClass* cls, void* p){
+    Slab* slab = slabOf(p);
+    *(void**)p = slab->free_list;
+    slab->free_list = p;
+    if(slab->used-- == slab->capacity){
+        slabListPush(cls, slab);
+    }
+    statSub(cls->objects, 1);
+    if(slab->used == 0 && (slab->next != nullptr || slab->prev != nullptr)){
+        slabListRemove(cls, slab);
+        statSub(cls->slabs, 1);
+        pthread_mutex_lock(&slabRegionLock);
+        *(void**)slab = slabFreePages;
+        slabFreePages = slab;
+        pthread_mutex_unlock(&slabRegionLock);
     }
+}
 
-    it = &metaDataHead;
+static SlabClass* slabClassOf(size_t size){
+    pthread_once(&slabClassesOnce, slabClassesInit);
+    return &slabClasses[size / X64_BIT_IN_BYTES];
+}
 
-    //check if the requested size can be fitted in a free'd allocated block
-    while(it != nullptr){
-        if(it->is_free && it->size >= size){
-            splitter((void*)it, size);
-            it->is_free = false;
-            //returns the address after the metaData.
-            return it+1;
+/*
+ * per thread cache of small objects, indexed by usable size in 8 bytes steps.
+ * it holds both slab objects and heap blocks (which are still marked as used in their arena
+ * so nobody merges them), chained through their first data word and handed out again
+ * without taking any lock. each of them goes back to its own slab or arena when drained.
+ */
+struct TCache{
+    void* entries[TCACHE_BINS];
+    unsigned int counts[TCACHE_BINS];
+    //tcacheStats(), kept here so the hot paths don't check whether it was created
+    TCacheStats* stats;
+    //requested bytes left until the profiler's next sample, and the state of its random intervals
+    long sampleCountdown;
+    uint64_t sampleSeed;
+
+    TCache() : entries(), counts(), stats(&tcacheStats()), sampleCountdown(0), sampleSeed((uintptr_t)this | 1) {}
+
+    ~TCache();
+};
+
+static thread_local TCache tcache;
+
+static void tcachePush(size_t i, void* p){
+    *(void**)p = tcache.entries[i];
+    tcache.entries[i] = p;
+    ++tcache.counts[i];
+    tcache.stats->blocks.add(1);
+    tcache.stats->bytes.add(i * X64_BIT_IN_BYTES);
+}
+
+static void* tcachePop(size_t i){
+    void* p = tcache.entries[i];
+    tcache.entries[i] = *(void**)p;
+    --tcache.counts[i];
+    tcache.stats->blocks.add(-1);
+    tcache.stats->bytes.add(-(long)(i * X64_BIT_IN_BYTES));
+    return p;
+}
+
+/*
+ * gives cached objects of bin i back to their slabs and arenas until only "keep" are left.
+ * consecutive objects with the same owner are freed under a single lock.
+ */
+static void tcacheFlush(size_t i, unsigned int keep){
+    pthread_mutex_t* locked = nullptr;
+    while(tcache.counts[i] > keep){
+        void* p = tcachePop(i);
+        SlabClass* cls = nullptr;
+        Arena* arena = nullptr;
+        pthread_mutex_t* lock;
+        if(inSlabRegion(p)){
+            cls = slabClassOf(slabOf(p)->object_size);
+            lock = &cls->lock;
+        } else {
+            arena = arenaOf(dataBlock(p));
+            lock = &arena->lock;
+        }
+        if(lock != locked){
+            if(locked != nullptr){
+                pthread_mutex_unlock(locked);
+            }
+            locked = lock;
+            pthread_mutex_lock(locked);
+        }
+        if(cls != nullptr){
+            slabFreeLocked(cls, p);
+        } else {
+            heapFree(arena, dataBlock(p));
+        }
+    }
+    if(locked != nullptr){
+        pthread_mutex_unlock(locked);
+    }
+}
+
+//a thread which exits gives its cached objects back to their slabs and arenas
+TCache::~TCache(){
+    for(size_t i = 0 ; i < TCACHE_BINS ; ++i){
+        tcacheFlush(i, 0);
+    }
+}
+
+/*
+ * returns the number of objects and bytes held by all the threads' caches,
+ * and adds the requests of every size class to "requests" if it isn't nullptr.
+ * the stripes keep counting after their threads exit, so this is a fixed amount of work.
+ */
+static void tcacheTotals(size_t* blocks, size_t* bytes, size_t* requests = nullptr){
+    TCacheStats& stats = tcacheStats();
+    *blocks = stats.blocks.sum();
+    *bytes = stats.bytes.sum();
+    for(size_t i = 0 ; requests != nullptr && i < MALLOC_SIZE_CLASSES ; ++i){
+        requests[i] += stats.requests[i].sum();
+    }
+}
+
+/*
+ * returns a cached object of "size" bytes, if the cache is empty it's taken from the size's
+ * slab class (or the thread's arena above SLAB_MAX_SIZE) along with up to TCACHE_REFILL more
+ * objects for the cache, all under a single lock.
+ * slab sizes fall back to heap blocks once the slab region is used up.
+ * returns nullptr if nothing could supply the object.
+ */
+static void* tcacheGet(size_t size){
+    size_t i = size / X64_BIT_IN_BYTES;
+    if(tcache.entries[i] != nullptr){
+        return tcachePop(i);
+    }
+    if(size <= SLAB_MAX_SIZE){
+        SlabClass* cls = slabClassOf(size);
+        pthread_mutex_lock(&cls->lock);
+        void* ret = slabAllocLocked(cls, size, true);
+        //the refill only takes what's already carved, it never creates slabs of its own
+        for(int j = 0 ; ret != nullptr && j < TCACHE_REFILL ; ++j){
+            void* p = slabAllocLocked(cls, size, false);
+            if(p == nullptr) break;
+            tcachePush(i, p);
+        }
+        pthread_mutex_unlock(&cls->lock);
+        if(ret != nullptr){
+            return ret;
+        }
+        MallocMetadata* pmeta = arenaAlloc(adjustSize(size));
+        return pmeta != nullptr ? blockData(pmeta) : nullptr;
+    }
+
+    Arena* arena = getThreadArena();
+    pthread_mutex_lock(&arena->lock);
+    MallocMetadata* ret = heapAlloc(arena, size);
+    for(int j = 0 ; ret != nullptr && j < TCACHE_REFILL ; ++j){
+        MallocMetadata* pmeta = heapAlloc(arena, size);
+        if(pmeta == nullptr) break;
+        //a block which couldn't be split exactly means there's nothing left to carve cheaply
+        if(blockSize(pmeta) != size){
+            heapFree(arena, pmeta);
+            break;
+        }
+        tcachePush(i, blockData(pmeta));
+    }
+    pthread_mutex_unlock(&arena->lock);
+    if(ret == nullptr){
+        //the thread's arena is used up, arenaAlloc falls back to the main arena
+        ret = arenaAlloc(size);
+    }
+    return ret != nullptr ? blockData(ret) : nullptr;
+}
+
+/*
+ * caches a freed object of "size" usable bytes, if its bin is full half of it is given back first.
+ */
+static void tcachePut(void* p, size_t size){
+    size_t i = size / X64_BIT_IN_BYTES;
+    if(tcache.counts[i] >= TCACHE_BIN_COUNT){
+        tcacheFlush(i, TCACHE_BIN_COUNT / 2);
+    }
+    tcachePush(i, p);
+}
+
+/*
+ * the sampling profiler: a thread samples a request once the bytes it requested since its last sample
+ * pass a random interval, whose mean is profileRate. profileSites is an open addressing table
+ * keyed by callsite, a slot's callsite is set once (until a reset) and its counters only grow.
+ */
+struct ProfileSite{
+    std::atomic<void*> callsite;
+    std::atomic<size_t> samples;
+    std::atomic<size_t> bytes;
+};
+
+//0 while the profiler is stopped
+static std::atomic<size_t> profileRate(0);
+static ProfileSite profileSites[MALLOC_PROFILE_SITES];
+
+static void profileRecord(size_t size, void* callsite){
+    size_t i = ((uintptr_t)callsite >> 2) * 0x9E3779B97F4A7C15UL % MALLOC_PROFILE_SITES;
+    for(size_t probes = 0 ; probes < MALLOC_PROFILE_SITES ; ++probes, i = (i + 1) % MALLOC_PROFILE_SITES){
+        ProfileSite* site = &profileSites[i];
+        void* current = site->callsite.load(std::memory_order_relaxed);
+        if(current == nullptr && site->callsite.compare_exchange_strong(current, callsite,
+                std::memory_order_relaxed)){
+            current = callsite;
+        }
+        if(current == callsite){
+            site->samples.fetch_add(1, std::memory_order_relaxed);
+            site->bytes.fetch_add(size, std::memory_order_relaxed);
+            return;
         }
-        //used for saving the last node for later use to avoid going over the list twice
-        if(it->next == nullptr) break;
-        it = it->next;
     }
+    //the table is full, the sample is dropped
+}
 
-    //it can't be null since it starts by pointing to metaDataHead
-    //and the while loop breaks before it is changed to nullptr.
-    if(it->is_free && it != &metaDataHead){
-        //if we're here then for sure it->size < size ; so we can just enlarge this block
-        expandTopBlock(it, size);
-        it->is_free = false;
-        return it+1;
+/*
+ * counts a request of "size" bytes made from "callsite" in the histogram and maybe samples it.
+ */
+static void noteRequest(size_t size, void* callsite){
+    if(size == 0 || size > MAX_SIZE){
+        return;
+    }
+    size_t cls = size <= 1 ? 0 : BITS_IN_WORD - __builtin_clzl(size - 1);
+    tcache.stats->requests[cls < MALLOC_SIZE_CLASSES ? cls : MALLOC_SIZE_CLASSES - 1].add(1);
+    size_t rate = profileRate.load(std::memory_order_relaxed);
+    if(rate == 0 || (tcache.sampleCountdown -= size) > 0){
+        return;
     }
+    profileRecord(size, callsite);
+    //xorshift, the next interval is uniform in [rate/2, 3*rate/2)
+    tcache.sampleSeed ^= tcache.sampleSeed << 13;
+    tcache.sampleSeed ^= tcache.sampleSeed >> 7;
+    tcache.sampleSeed ^= tcache.sampleSeed << 17;
+    tcache.sampleCountdown = rate / 2 + tcache.sampleSeed % (rate + 1);
+}
 
-    void* ret = sbrk(size+sizeof(MallocMetadata));
+static void* allocate(size_t size){
 
-    if(ret == SBRK_FAIL)
+    //check for invalid input
+    if(size == 0 || size > MAX_SIZE){
         return nullptr;
+    }
 
-    auto* metaData = (MallocMetadata*)ret;
-    *metaData = MallocMetadata(size);
+    //tiny objects are served by the slabs
+    size += alignToEight(size);
+    if(size <= SLAB_MAX_SIZE){
+        return tcacheGet(size);
+    }
+
+    size = adjustSize(size);
+
+    if(size >= MMAP_SIZE){
+        return smmap(size);
+    }
 
-    //update the list of allocated areas
-    metaData->prev = it;
-    it->next = metaData;
+    if(size < TCACHE_MAX_SIZE){
+        return tcacheGet(size);
+    }
+
+    MallocMetadata* it = arenaAlloc(size);
+    if(it == nullptr)
+        return nullptr;
 
     //returns the address after the metaData.
-    return metaData+1;
+    return blockData(it);
+}
+
+void* smalloc(size_t size){
+    noteRequest(size, __builtin_return_address(0));
+    return allocate(size);
 }
 
 void* scalloc(size_t num, size_t size){
     //everything in scalloc is the same as in smalloc so we will use smalloc
     //and then set the necessary bytes to 0.
-    void* ret = smalloc(num*size);
+    noteRequest(num*size, __builtin_return_address(0));
+    void* ret = allocate(num*size);
     if(ret == nullptr){
         return nullptr;
     }
@@ -259,186 +1333,250 @@ void sfree(void* p){
     if (p == nullptr){
         return;
     }
+    if(inSlabRegion(p)){
+        return tcachePut(p, slabOf(p)->object_size);
+    }
     //for ease of use
-    MallocMetadata* pmeta = ((MallocMetadata*)(p)-1);
+    MallocMetadata* pmeta = dataBlock(p);
 
-    //-1 to move the pointer to the metaData, then marking this block as free
-    pmeta->is_free = true;
-    if(pmeta->size >= MMAP_SIZE){
+    if(loadHeader(pmeta) & MMAPPED_BIT){
          return smunmap(pmeta);
     }
-    metaDataMerger(pmeta);
+    if(blockSize(pmeta) < TCACHE_MAX_SIZE){
+        return tcachePut(p, blockSize(pmeta));
+    }
+    //the block goes back to the arena which owns it, not to the calling thread's
+    Arena* arena = arenaOf(pmeta);
+    pthread_mutex_lock(&arena->lock);
+    heapFree(arena, pmeta);
+    pthread_mutex_unlock(&arena->lock);
 }
 
 void* srealloc(void* oldp, size_t size){
     if (size == 0 || size > MAX_SIZE){
         return nullptr;
     }
+    noteRequest(size, __builtin_return_address(0));
 
     //in case oldp is nullptr we need only to allocate new block of size size
     if (oldp == nullptr){
-        return smalloc(size);
+        return allocate(size);
     }
 
+    //a slab object can't grow, it either still fits or moves to a new object
+    if(inSlabRegion(oldp)){
+        size_t old_size = slabOf(oldp)->object_size;
+        if(size <= old_size){
+            return oldp;
+        }
+        void* newp = allocate(size);
+        if(newp == nullptr){
+            return nullptr;
+        }
+        std::memcpy(newp, oldp, old_size);
+        sfree(oldp);
+        return newp;
+    }
+
+    //blocks are split by this size so it has to keep the next header aligned
+    size = adjustSize(size);
 
     //for ease of use
-    MallocMetadata* pmeta = (MallocMetadata*)(oldp)-1;
+    MallocMetadata* pmeta = dataBlock(oldp);
 
     //check if the block was allocated using mmap and if was then need to delete the block
     //and allocate new one using mmap
-    if(pmeta->size >= MMAP_SIZE){
+    if(loadHeader(pmeta) & MMAPPED_BIT){
         void* newp = smmap(size);
+        if(newp == nullptr){
+            return nullptr;
+        }
         size_t size_to_copy;
-        size >= pmeta->size ? size_to_copy = pmeta->size : size_to_copy = size;
+        size >= blockSize(pmeta) ? size_to_copy = blockSize(pmeta) : size_to_copy = size;
         newp = std::memmove(newp, oldp, size_to_copy);
         smunmap(pmeta);
         return newp;
     }
 
-
-    //checks if the wanted new size is smaller than than older size then no need to do nothing
-    //as the old block is large enough
-    if(pmeta->size >= size){
-        //just to make splitter to accept this block
-        pmeta->is_free = true;
-        pmeta = (MallocMetadata*)splitter(pmeta, size);
-        pmeta->is_free = false;
-        return oldp;
-    }
-
-
-    //if the block is "wilderness" we need only to enlarge it using sbrk()
-    if(pmeta->next == nullptr){
-        sbrk(size - pmeta->size);
-        pmeta->size = size;
-        return oldp;
-    }
-
-    //checking if merging with prev block is enough
-    if(pmeta->prev != &metaDataHead && pmeta->prev->is_free){
-        if(pmeta->size + pmeta->prev->size + sizeof(MallocMetadata) >= size){
-            pmeta = metaDataMergerPrev(pmeta);
-            //in case we merged with block which is too big
-            auto* newp = (MallocMetadata*)std::memmove(pmeta+1, oldp, size);
-            newp = (MallocMetadata*)splitter(newp-1, size);
-            return newp+1;
-        }
-    }
-
-    //checking if merging with next block is enough
-    if(pmeta->next != nullptr && pmeta->next->is_free){
-        if(pmeta->size + pmeta->next->size + sizeof(MallocMetadata) >= size){
-            pmeta = metaDataMergerNext(pmeta);
-            //in case we merged with block which is too big
-            splitter(pmeta, size);
-            pmeta->is_free = false;
-            return pmeta+1;
-        }
-    }
-
-    //checking if merging with both next and prev is enough
-    if(pmeta->prev != &metaDataHead && pmeta->prev->is_free
-        && pmeta->next != nullptr && pmeta->next->is_free
-        && pmeta->size + pmeta->prev->size + pmeta->next->size + (2*sizeof(MallocMetadata)) >= size){
-        pmeta = metaDataMergerPrev(pmeta);
-        pmeta = metaDataMergerNext(pmeta);
-        //in case we merged with block which is too big
-        auto* newp = (MallocMetadata*)std::memmove(pmeta+1, oldp, size);
-        newp = (MallocMetadata*)splitter(newp-1, size);
-        pmeta->is_free = false;
-        return newp+1;
+    Arena* arena = arenaOf(pmeta);
+    pthread_mutex_lock(&arena->lock);
+    void* newp = heapRealloc(arena, pmeta, size);
+    pthread_mutex_unlock(&arena->lock);
+    if(newp != nullptr){
+        return newp;
     }
 
-    void* newp = smalloc(size);
+    newp = allocate(size);
 
     //if newp is nullptr then sbrk failed so we will return nullptr and not freeing the oldp
     if (newp == nullptr){
         return nullptr;
     }
 
-    newp = std::memmove(newp, oldp, pmeta->size);
+    newp = std::memmove(newp, oldp, blockSize(pmeta));
     sfree(oldp);
 
     return newp;
 }
 
-size_t _num_free_blocks(){
-    size_t freeBlocks = 0;
-    //first node is a dummy
-    MallocMetadata* it = metaDataHead.next;
-
-    while(it != nullptr){
-        //counting only free blocks
-        if(it->is_free){
-            ++freeBlocks;
+/*
+ * adds up the blocks of all the arenas and the free ones among them, with their bytes.
+ */
+static void arenasTotals(size_t* blocks, size_t* bytes, size_t* free_blocks, size_t* free_bytes){
+    *blocks = *bytes = *free_blocks = *free_bytes = 0;
+    size_t n = arenaCount();
+    for(size_t i = 0 ; i < n ; ++i){
+        Arena* arena = arenas[i].load(std::memory_order_acquire);
+        if(arena == nullptr){
+            continue;
         }
-        it = it->next;
+        *blocks += arena->numBlocks.load(std::memory_order_relaxed);
+        *bytes += arena->numBytes.load(std::memory_order_relaxed);
+        *free_blocks += arena->freeBlocks.load(std::memory_order_relaxed);
+        *free_bytes += arena->freeBytes.load(std::memory_order_relaxed);
     }
-    return freeBlocks;
 }
 
-size_t _num_free_bytes(){
-    size_t freeBytes = 0;
-    //first node is dummy
-    MallocMetadata* it = metaDataHead.next;
-
-    while(it != nullptr){
-        //counting only bytes of free bytes
-        if(it->is_free){
-            freeBytes += it->size;
-        }
-        it = it->next;
+/*
+ * counts the objects handed out of slabs, their bytes and the slabs themselves.
+ */
+static void slabTotals(size_t* objects, size_t* bytes, size_t* slabs){
+    *objects = 0;
+    *bytes = 0;
+    *slabs = 0;
+    for(size_t i = 1 ; i <= SLAB_CLASSES ; ++i){
+        size_t class_objects = slabClasses[i].objects.load(std::memory_order_relaxed);
+        *objects += class_objects;
+        *bytes += class_objects * i * X64_BIT_IN_BYTES;
+        *slabs += slabClasses[i].slabs.load(std::memory_order_relaxed);
     }
+}
 
-    return freeBytes;
+void _malloc_stats(MallocStats* stats){
+    std::memset(stats, 0, sizeof(*stats));
+    arenasTotals(&stats->heap_blocks, &stats->heap_bytes, &stats->free_blocks, &stats->free_bytes);
+    tcacheTotals(&stats->cached_blocks, &stats->cached_bytes, stats->size_histogram);
+    slabTotals(&stats->slab_objects, &stats->slab_bytes, &stats->slabs);
+    stats->mmap_blocks = mmapBlocks.load(std::memory_order_relaxed);
+    stats->mmap_bytes = mmapBytes.load(std::memory_order_relaxed);
+    //the counters are read at slightly different times, so the differences are clamped
+    size_t used_blocks = stats->heap_blocks - stats->free_blocks + stats->mmap_blocks + stats->slab_objects;
+    size_t used_bytes = stats->heap_bytes - stats->free_bytes + stats->mmap_bytes + stats->slab_bytes;
+    stats->allocated_blocks = used_blocks > stats->cached_blocks ? used_blocks - stats->cached_blocks : 0;
+    stats->allocated_bytes = used_bytes > stats->cached_bytes ? used_bytes - stats->cached_bytes : 0;
+    stats->footprint_bytes = footprint.load(std::memory_order_relaxed);
+    stats->peak_footprint_bytes = peakFootprint.load(std::memory_order_relaxed);
+    stats->sbrk_calls = sbrkCalls.load(std::memory_order_relaxed);
+    stats->mmap_calls = mmapCalls.load(std::memory_order_relaxed);
+    stats->munmap_calls = munmapCalls.load(std::memory_order_relaxed);
+    stats->fragmentation = stats->heap_bytes == 0 ? 0 : (double)stats->free_bytes / stats->heap_bytes;
 }
 
-size_t _num_allocated_blocks(){
-    size_t allocatedBlocks = 0;
-    //first node is dummy
-    MallocMetadata* it = metaDataHead.next;
+void _malloc_profile_start(size_t sample_bytes){
+    profileRate.store(sample_bytes, std::memory_order_relaxed);
+}
 
-    while(it != nullptr){
-        //counting all blocks free and used
-        ++allocatedBlocks;
-        it = it->next;
-    }
+void _malloc_profile_stop(){
+    profileRate.store(0, std::memory_order_relaxed);
+}
 
-    //same thing for the mmap linked list
-    it = mmapDataHead.next;
-    while(it != nullptr){
-        ++allocatedBlocks;
-        it = it->next;
+size_t _malloc_profile_report(MallocSite* sites, size_t max_sites){
+    size_t n = 0;
+    for(size_t i = 0 ; i < MALLOC_PROFILE_SITES && n < max_sites ; ++i){
+        void* callsite = profileSites[i].callsite.load(std::memory_order_relaxed);
+        if(callsite == nullptr){
+            continue;
+        }
+        sites[n].callsite = callsite;
+        sites[n].samples = profileSites[i].samples.load(std::memory_order_relaxed);
+        sites[n].sampled_bytes = profileSites[i].bytes.load(std::memory_order_relaxed);
+        ++n;
     }
+    return n;
+}
 
-    return allocatedBlocks;
+/*
+ * samples taken while the table is being reset may be lost or counted for the wrong callsite.
+ */
+void _malloc_profile_reset(){
+    for(size_t i = 0 ; i < MALLOC_PROFILE_SITES ; ++i){
+        profileSites[i].samples.store(0, std::memory_order_relaxed);
+        profileSites[i].bytes.store(0, std::memory_order_relaxed);
+        profileSites[i].callsite.store(nullptr, std::memory_order_relaxed);
+    }
 }
 
-size_t _num_allocated_bytes(){
-    size_t freeBytes = 0;
-    //first node is dummy
-    MallocMetadata* it = metaDataHead.next;
+/*
+ * the statistics look at the heap as a whole, objects sitting in the threads' caches
+ * are counted as free even though their arenas and slabs consider them used.
+ * every handed out slab object counts as an allocated block.
+ */
+size_t _num_free_blocks(){
+    size_t blocks, bytes, freeBlocks, freeBytes, cachedBlocks, cachedBytes;
+    arenasTotals(&blocks, &bytes, &freeBlocks, &freeBytes);
+    tcacheTotals(&cachedBlocks, &cachedBytes);
+    return freeBlocks + cachedBlocks;
+}
 
-    while(it != nullptr){
-        //counting all sizes free and used
-        freeBytes += it->size;
-        it = it->next;
-    }
+size_t _num_free_bytes(){
+    size_t blocks, bytes, freeBlocks, freeBytes, cachedBlocks, cachedBytes;
+    arenasTotals(&blocks, &bytes, &freeBlocks, &freeBytes);
+    tcacheTotals(&cachedBlocks, &cachedBytes);
+    return freeBytes + cachedBytes;
+}
 
-    //same thing for mmap linked list
-    it = mmapDataHead.next;
-    while(it != nullptr){
-        freeBytes += it->size;
-        it = it->next;
-    }
+size_t _num_allocated_blocks(){
+    size_t heapBlocks, heapBytes, freeBlocks, freeBytes, slabObjects, slabBytes, slabs;
+    arenasTotals(&heapBlocks, &heapBytes, &freeBlocks, &freeBytes);
+    slabTotals(&slabObjects, &slabBytes, &slabs);
+    return heapBlocks + mmapBlocks + slabObjects;
+}
 
-    return freeBytes;
+size_t _num_allocated_bytes(){
+    size_t heapBlocks, heapBytes, freeBlocks, freeBytes, slabObjects, slabBytes, slabs;
+    arenasTotals(&heapBlocks, &heapBytes, &freeBlocks, &freeBytes);
+    slabTotals(&slabObjects, &slabBytes, &slabs);
+    return heapBytes + mmapBytes + slabBytes;
 }
 
+/*
+ * every block carries just its header word, the footers of free blocks lie inside
+ * their data so they're already counted by _num_free_bytes().
+ * slab objects have no header, their slab's header is shared by the whole page.
+ */
 size_t _num_meta_data_bytes(){
-    return _num_allocated_blocks() * sizeof(MallocMetadata);
+    size_t heapBlocks, heapBytes, freeBlocks, freeBytes, slabObjects, slabBytes, slabs;
+    arenasTotals(&heapBlocks, &heapBytes, &freeBlocks, &freeBytes);
+    slabTotals(&slabObjects, &slabBytes, &slabs);
+    return (heapBlocks + mmapBlocks) * META_DATA_SIZE + slabs * sizeof(Slab);
 }
 
 size_t _size_meta_data(){
-    return sizeof(MallocMetadata);
+    return META_DATA_SIZE;
+}
+
+/*
+ * gives all the memory it can back to the system: every arena's free top block is cut down to "pad"
+ * bytes and the pages inside all the other free blocks are released.
+ * objects sitting in the threads' caches are still in use as far as their arenas know, so they stay.
+ * returns 1 if any memory was given back, 0 otherwise.
+ */
+int strim(size_t pad){
+    bool released = false;
+    size_t n = arenaCount();
+    for(size_t i = 0 ; i < n ; ++i){
+        Arena* arena = arenas[i].load(std::memory_order_acquire);
+        if(arena == nullptr){
+            continue;
+        }
+        pthread_mutex_lock(&arena->lock);
+        released |= arenaTrim(arena, pad);
+        for(size_t bin = nextNonEmptyBin(arena, 0) ; bin < NUM_BINS ; bin = nextNonEmptyBin(arena, bin + 1)){
+            for(MallocMetadata* it = arena->bins[bin] ; it != nullptr ; it = it->next_free){
+                released |= releaseFreeBlock(it, (char*)it, (char*)nextBlock(it));
+            }
+        }
+        pthread_mutex_unlock(&arena->lock);
+    }
+    return released ? 1 : 0;
 }
@@ -0,0 +1,86 @@
+#ifndef MALLOC_STATS_H_
+#define MALLOC_STATS_H_
+
+#include <cstddef>
+
+/*
+ * statistics and sampling profiler of the allocator in malloc.cpp.
+ * every query reads counters the allocator keeps up to date as it goes, so its cost doesn't depend on
+ * the number of blocks and it takes no lock an allocation may be waiting for.
+ * the counters are read one by one while other threads allocate, so a snapshot is only consistent
+ * when the heap is quiet.
+ */
+
+//requests of 2^(i-1)+1 to 2^i bytes are counted in size_histogram[i], the last class ends at MAX_SIZE
+#define MALLOC_SIZE_CLASSES 28
+//callsites the profiler keeps apart, samples of any further callsite are dropped
+#define MALLOC_PROFILE_SITES 1024
+
+struct MallocStats{
+    //blocks and bytes in use by the program: heap blocks, mmap'd blocks and slab objects not in any cache
+    size_t allocated_blocks;
+    size_t allocated_bytes;
+    //all the blocks of the arenas, used or free
+    size_t heap_blocks;
+    size_t heap_bytes;
+    //free heap blocks, and the objects sitting in the threads' caches
+    size_t free_blocks;
+    size_t free_bytes;
+    size_t cached_blocks;
+    size_t cached_bytes;
+    size_t mmap_blocks;
+    size_t mmap_bytes;
+    size_t slab_objects;
+    size_t slab_bytes;
+    size_t slabs;
+    //memory taken from the system (sbrk'd heap, grown arenas, slab pages and mmap'd blocks), now and at its peak
+    size_t footprint_bytes;
+    size_t peak_footprint_bytes;
+    size_t sbrk_calls;
+    size_t mmap_calls;
+    size_t munmap_calls;
+    //free_bytes / heap_bytes, 0 for an empty heap
+    double fragmentation;
+    //smalloc/scalloc/srealloc requests by size class, since the process started
+    size_t size_histogram[MALLOC_SIZE_CLASSES];
+};
+
+struct MallocSite{
+    //the address smalloc/scalloc/srealloc returns to
+    void* callsite;
+    size_t samples;
+    //bytes requested by the sampled calls
+    size_t sampled_bytes;
+};
+
+void _malloc_stats(MallocStats* stats);
+
+/*
+ * starts sampling the allocations: roughly one request per "sample_bytes" requested bytes is recorded
+ * along with its callsite. 0 stops the profiler, the samples taken so far are kept.
+ */
+void _malloc_profile_start(size_t sample_bytes);
+void _malloc_profile_stop();
+
+/*
+ * copies up to "max_sites" callsites with their samples to "sites", returns how many were copied.
+ */
+size_t _malloc_profile_report(MallocSite* sites, size_t max_sites);
+
+//forgets all the samples
+void _malloc_profile_reset();
+
+/*
+ * gives the free memory of the heap back to the system, keeping "pad" bytes at the top of every arena.
+ * returns 1 if any memory was released (see strim in malloc.cpp).
+ */
+int strim(size_t pad);
+
+size_t _num_free_blocks();
+size_t _num_free_bytes();
+size_t _num_allocated_blocks();
+size_t _num_allocated_bytes();
+size_t _num_meta_data_bytes();
+size_t _size_meta_data();
+
+#endif // MALLOC_STATS_H_
@@ -0,0 +1,153 @@
+/*
+ * regression test of the heap in malloc.cpp giving memory back to the system: a free top block above
+ * TRIM_THRESHOLD is trimmed, a free block is released once when merging makes it big enough, and the
+ * statistics count every sbrk() call exactly once.
+ * the heap checks need the calling thread to allocate from the main arena (the sbrk'd one), so the test
+ * runs on cpu 0 and skips them if it can't.
+ * build: g++ -std=c++17 -O2 -pthread malloc_test.cpp malloc.cpp -o malloc_test
+ * usage: malloc_test
+ * prints the failed checks and exits with 1 if there were any.
+ */
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "malloc_stats.h"
+
+void* smalloc(size_t size);
+void sfree(void* p);
+
+#define KB 1024
+#define PAGE_SIZE (4*KB)
+
+static unsigned long failures = 0;
+
+static void check(bool ok, const char* test, const char* what){
+    if(!ok){
+        ++failures;
+        fprintf(stderr, "%s: %s\n", test, what);
+    }
+}
+
+static size_t sbrkCalls(){
+    MallocStats stats;
+    _malloc_stats(&stats);
+    return stats.sbrk_calls;
+}
+
+/*
+ * returns true if the page which holds p is in memory.
+ */
+static bool resident(void* p){
+    unsigned char vec = 0;
+    void* page = (void*)((uintptr_t)p & ~((uintptr_t)PAGE_SIZE - 1));
+    return mincore(page, PAGE_SIZE, &vec) == 0 && (vec & 1);
+}
+
+static void* filled(size_t size){
+    void* p = smalloc(size);
+    if(p != nullptr){
+        memset(p, 1, size);
+    }
+    return p;
+}
+
+/*
+ * three 100KB blocks at the top of the heap, freed together make a 300KB top block:
+ * above TRIM_THRESHOLD but below RELEASE_THRESHOLD, it's still cut down with a negative sbrk().
+ */
+static void trimTest(){
+    const char* test = "trim";
+    void* blocks[3];
+    for(void*& p : blocks){
+        p = filled(100 * KB);
+    }
+    char* end = (char*)sbrk(0);
+    size_t calls = sbrkCalls();
+    for(void* p : blocks){
+        sfree(p);
+    }
+    check((char*)sbrk(0) < end - 200 * KB, test, "the break didn't move back");
+    //sbrk(0) to make sure nobody moved the break, and the negative sbrk()
+    check(sbrkCalls() == calls + 2, test, "the trim wasn't counted as two sbrk calls");
+}
+
+/*
+ * when somebody else moved the break the top can't be trimmed, only the sbrk(0) which found out is counted.
+ */
+static void foreignBreakTest(){
+    const char* test = "foreign break";
+    void* blocks[3];
+    for(void*& p : blocks){
+        p = filled(100 * KB);
+    }
+    if(sbrk(PAGE_SIZE) == (void*)-1){
+        check(false, test, "couldn't move the break");
+        return;
+    }
+    char* end = (char*)sbrk(0);
+    size_t calls = sbrkCalls();
+    for(void* p : blocks){
+        sfree(p);
+    }
+    check((char*)sbrk(0) == end, test, "the break moved");
+    check(sbrkCalls() == calls + 1, test, "the failed trim wasn't counted as a single sbrk call");
+}
+
+/*
+ * 60KB blocks below RELEASE_THRESHOLD each, freed one by one: once they merge into a block above it
+ * all their pages are released, including those of the blocks freed earlier.
+ * a block freed into it afterwards keeps its pages.
+ */
+static void releaseTest(){
+    const char* test = "release";
+    std::vector<char*> blocks;
+    for(int i = 0; i < 40; ++i){
+        blocks.push_back((char*)filled(60 * KB));
+    }
+    //keeps the freed blocks off the top, so they're released rather than trimmed
+    void* guard = filled(64);
+    for(char* p : blocks){
+        check(resident(p + 30 * KB), test, "a used block isn't in memory");
+    }
+    for(char* p : blocks){
+        sfree(p);
+    }
+    unsigned int released = 0;
+    for(char* p : blocks){
+        released += !resident(p + 30 * KB);
+    }
+    check(released == blocks.size(), test, "the merged block wasn't released as a whole");
+
+    char* p = (char*)filled(100 * KB);
+    sfree(p);
+    check(resident(p + 50 * KB), test, "a small block freed into a released one was released again");
+    sfree(guard);
+}
+
+int main(){
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+
+    //the first allocation picks the thread's arena
+    sfree(smalloc(64 * KB));
+    if(sbrkCalls() == 0){
+        printf("not on the main arena, skipped\n");
+        return 0;
+    }
+    trimTest();
+    releaseTest();
+    //last, the foreign memory stays in the heap
+    foreignBreakTest();
+    if(failures != 0){
+        printf("%lu checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -1,91 +1,167 @@
 #include <stdlib.h>
+#include "memory_pool.h"
 
-#define DIVISION 10
-//used to store the address of 1st block, not necessary the beginning of memory_pool
-int32_t* first_block_ptr;
+//blocks are aligned like anything malloc returns, so any object can be stored in them
+#define POOL_ALIGNMENT _Alignof(max_align_t)
+
+static size_t align_up(size_t size){
+    return (size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+}
 
 /*
- * returns pointer to the first free sub-block
- * returns null in-case no free sub-blocks left
+ * the header of every chunk the pool allocates, the chunk's blocks follow it.
+ * the chunks are linked only so the pool can free them when it's destroyed.
  */
-int32_t* my_malloc(void){
-    //in-case of DIVISION equal to 1 we only need to mark first_block_ptr as used (NULL)
-    if(DIVISION == 1){
-        int32_t* ret_val = first_block_ptr;
-        first_block_ptr = NULL;
-        return ret_val;
+struct pool_chunk{
+    struct pool_chunk* next;
+};
+
+#define CHUNK_HEADER_SIZE align_up(sizeof(struct pool_chunk))
+
+struct memory_pool{
+    size_t block_size;
+    size_t grow_blocks;
+    //head of the free blocks list, the first word of each free block is the address of the next one
+    void* free_list;
+    //the part of the newest chunk which hasn't been handed out yet, blocks are carved from it
+    //only when free_list is empty so creating or growing the pool doesn't touch all of its memory
+    char* unused;
+    char* unused_end;
+    struct pool_chunk* chunks;
+    size_t used_blocks;
+    size_t total_blocks;
+};
+
+/*
+ * allocates a new chunk of num_blocks blocks and makes it the pool's unused memory.
+ * returns 0 in-case of memory allocation failure
+ */
+static int pool_grow(memory_pool* pool, size_t num_blocks){
+    if(num_blocks == 0 || num_blocks > (SIZE_MAX - CHUNK_HEADER_SIZE) / pool->block_size){
+        return 0;
+    }
+    struct pool_chunk* chunk = (struct pool_chunk*) malloc(CHUNK_HEADER_SIZE + num_blocks * pool->block_size);
+    if(chunk == NULL){
+        return 0;
+    }
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    //whatever was left of the previous chunk is lost, it's less than a single block anyway
+    pool->unused = (char*)chunk + CHUNK_HEADER_SIZE;
+    pool->unused_end = pool->unused + num_blocks * pool->block_size;
+    pool->total_blocks += num_blocks;
+    return 1;
+}
+
+memory_pool* memory_pool_create(size_t block_size, size_t initial_blocks, size_t grow_blocks){
+    //a free block must be able to hold the address of the next one
+    if(block_size < sizeof(void*)){
+        block_size = sizeof(void*);
     }
-    //if first_block_ptr is null that means that there are no free sub-blocks left
-    if(first_block_ptr = NULL){
+    if(block_size > SIZE_MAX - POOL_ALIGNMENT){
         return NULL;
     }
-    /*
-     * if offset is 0, set first_block_ptr to null to indicate all data been used
-     * and return its location
-    */
-    if(*first_block_ptr == 0){
-        int32_t* ret_val = first_block_ptr;
-        first_block_ptr = NULL;
-        return ret_val;
+    memory_pool* pool = (memory_pool*) malloc(sizeof(memory_pool));
+    if(pool == NULL){
+        return NULL;
     }
-    int32_t* tmp = first_block_ptr;
-    //finding the last non 0 offset as the element after that will be the block which we'll return.
-    while(*(tmp+(*tmp)) != 0){
-        tmp += *tmp;
+    pool->block_size = align_up(block_size);
+    pool->grow_blocks = grow_blocks;
+    pool->free_list = NULL;
+    pool->unused = pool->unused_end = NULL;
+    pool->chunks = NULL;
+    pool->used_blocks = 0;
+    pool->total_blocks = 0;
+    if(initial_blocks != 0 && !pool_grow(pool, initial_blocks)){
+        free(pool);
+        return NULL;
     }
-    int32_t* ret_val = tmp+(*tmp);
-    *tmp = 0;
-    return  ret_val;
+    return pool;
 }
 
-
-void my_free(int32_t* ptr){
-    //in-case of DIVISION equal to 1 we only need to mark first_block_ptr as free
-    if(DIVISION == 1){
-        first_block_ptr = ptr;
+void memory_pool_destroy(memory_pool* pool){
+    if(pool == NULL){
         return;
     }
-    //if all blocks were used, use the ptr as the base of offset chain.
-    if(first_block_ptr == NULL){
-        first_block_ptr = ptr;
-        *first_block_ptr = 0;
-        return;
+    struct pool_chunk* chunk = pool->chunks;
+    while(chunk != NULL){
+        struct pool_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
     }
-    int32_t* tmp = first_block_ptr;
-    while(*tmp != 0){
-        tmp += *tmp;
+    free(pool);
+}
+
+void* memory_pool_alloc(memory_pool* pool){
+    void* ret_val = pool->free_list;
+    if(ret_val != NULL){
+        pool->free_list = *(void**)ret_val;
+    } else {
+        if(pool->unused == pool->unused_end && !pool_grow(pool, pool->grow_blocks)){
+            return NULL;
+        }
+        ret_val = pool->unused;
+        pool->unused += pool->block_size;
     }
-    //saving the offset to the new last element and setting its offset to 0.
-    *tmp = ptr-tmp;
-    *ptr = 0;
+    ++pool->used_blocks;
+    return ret_val;
 }
 
-/*
- * returns pointer to first block in-case of success
- * THIS BLOCK CANNOT BE USED, ONLY BLOCKS USED BY my_malloc.
- * returns NULL in-case of memory allocation failure
- */
+void memory_pool_free(memory_pool* pool, void* ptr){
+    if(ptr == NULL){
+        return;
+    }
+    *(void**)ptr = pool->free_list;
+    pool->free_list = ptr;
+    --pool->used_blocks;
+}
+
+size_t memory_pool_block_size(const memory_pool* pool){
+    return pool->block_size;
+}
+
+size_t memory_pool_used_blocks(const memory_pool* pool){
+    return pool->used_blocks;
+}
+
+size_t memory_pool_total_blocks(const memory_pool* pool){
+    return pool->total_blocks;
+}
+
+
+//the pool behind memory_init, my_malloc and my_free
+static memory_pool* default_pool = NULL;
+
 int32_t* memory_init(int32_t memory_size){
-    first_block_ptr = (int32_t*) malloc(memory_size);
-    if(first_block_ptr == NULL){
+    if(memory_size <= 0){
         return NULL;
     }
-    //in-case DIVISION is set to 1 we'll handle it differently
-    if(DIVISION == 1){
-        return first_block_ptr;
+    //rounded down, memory_pool_create would round it up and the pool would outgrow memory_size
+    size_t block_size = ((size_t)memory_size / DIVISION) & ~(POOL_ALIGNMENT - 1);
+    if(block_size == 0){
+        return NULL;
     }
-    //save the address to the beginning of the memory pool to return it in the end
-    int32_t* ret_val = first_block_ptr;
-
-    //each element will store the offset to next free element.
-    int32_t* tmp = first_block_ptr;
-    for(int i = 0 ; i < DIVISION-1 ; ++i){
-        //the offset to next element is constant
-        *tmp = memory_size/DIVISION;
-        tmp += memory_size/DIVISION;
+    memory_pool* pool = memory_pool_create(block_size, DIVISION, 0);
+    if(pool == NULL){
+        return NULL;
     }
-    //the last element offset will be 0 as it's the last element.
-    *tmp = 0;
+    memory_pool_destroy(default_pool);
+    default_pool = pool;
+    //the start of the pool's only chunk, its header sits before the first block
+    return (int32_t*)pool->chunks;
+}
 
-    return ret_val;
-}
\ No newline at end of file
+memory_pool* memory_default_pool(void){
+    return default_pool;
+}
+
+int32_t* my_malloc(void){
+    if(default_pool == NULL){
+        return NULL;
+    }
+    return (int32_t*) memory_pool_alloc(default_pool);
+}
+
+void my_free(int32_t* ptr){
+    memory_pool_free(default_pool, ptr);
+}
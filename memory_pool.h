@@ -0,0 +1,90 @@
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * a pool of fixed size blocks.
+ * free blocks are kept in an intrusive LIFO list (each free block holds the address of the next one),
+ * so both memory_pool_alloc and memory_pool_free are O(1).
+ * the blocks are carved from chunks which are allocated on demand, a chunk is never returned
+ * to the system before the pool is destroyed.
+ * a pool isn't thread safe, the caller must serialize the access to it.
+ */
+typedef struct memory_pool memory_pool;
+
+/*
+ * creates a pool of blocks of at least block_size bytes, aligned like anything malloc returns.
+ * initial_blocks blocks are allocated right away, and whenever the pool runs out of blocks it grows
+ * by a chunk of grow_blocks blocks. grow_blocks == 0 makes a fixed pool which never grows.
+ * returns NULL in-case of memory allocation failure
+ */
+memory_pool* memory_pool_create(size_t block_size, size_t initial_blocks, size_t grow_blocks);
+
+/*
+ * frees all the pool's memory, including the blocks which haven't been returned to it.
+ */
+void memory_pool_destroy(memory_pool* pool);
+
+/*
+ * returns a free block of the pool
+ * returns NULL in-case no free blocks left and the pool can't grow
+ */
+void* memory_pool_alloc(memory_pool* pool);
+
+/*
+ * returns a block which has been allocated from the pool back to it. ptr may be NULL.
+ */
+void memory_pool_free(memory_pool* pool, void* ptr);
+
+/*
+ * the actual size of the pool's blocks, after rounding up for alignment.
+ */
+size_t memory_pool_block_size(const memory_pool* pool);
+
+/*
+ * number of blocks which are currently allocated from the pool, and the number of blocks it holds.
+ */
+size_t memory_pool_used_blocks(const memory_pool* pool);
+size_t memory_pool_total_blocks(const memory_pool* pool);
+
+/*
+ * the original single pool interface, kept on top of a default pool of DIVISION blocks.
+ */
+#define DIVISION 10
+
+/*
+ * divides memory_size bytes into DIVISION blocks, replacing the previous default pool.
+ * the blocks are rounded down to the pool's alignment so together they take no more than memory_size bytes,
+ * a few bytes of memory_size may be left unused. the pool's own bookkeeping (its handle and the header
+ * in front of the blocks) is allocated on top of that.
+ * returns pointer to the beginning of the pool's memory in-case of success
+ * THIS ISN'T A BLOCK, ONLY BLOCKS RETURNED BY my_malloc CAN BE USED.
+ * returns NULL if memory_size is too small for DIVISION aligned blocks, or in-case of memory allocation failure
+ */
+int32_t* memory_init(int32_t memory_size);
+
+/*
+ * the default pool created by the last successful memory_init, so it can be used with the memory_pool_* functions.
+ * returns NULL before memory_init succeeds.
+ */
+memory_pool* memory_default_pool(void);
+
+/*
+ * returns pointer to a free block
+ * returns null in-case no free blocks left
+ */
+int32_t* my_malloc(void);
+
+void my_free(int32_t* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MEMORY_POOL_H